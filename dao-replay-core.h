@@ -0,0 +1,1875 @@
+/* dao-replay-core.h
+ * Simulator-independent core of the DAO replay mitigation: payload codecs,
+ * streaming statistics, the per-sender state table, the freshness policies,
+ * the validator the root runs per DAO, metrics output and DAO trace files.
+ *
+ * Shared by the ns-3 scenario (dao-replay-mitigation.cc), the standalone
+ * microbenchmark (dao-replay-bench.cc) and the offline trace driver
+ * (dao-trace-replay.cc); it must not include ns-3 headers.
+ * Per-packet debug logging goes through DAO_PKT_LOG, which the includer may
+ * define (the scenario maps it to NS_LOG); it is a no-op otherwise.
+ */
+
+#ifndef DAO_REPLAY_CORE_H
+#define DAO_REPLAY_CORE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef DAO_PKT_LOG
+// Disabled as ns-3 disables NS_LOG: arguments stay referenced and type-checked but
+// are never evaluated.
+#define DAO_PKT_LOG(level, msg) do { if (false) { std::clog << msg; } } while (false)
+#endif
+
+// ---------------------- Payload helpers ----------------------------------
+struct DaoPayload { uint32_t seq; uint64_t tsSeconds; uint64_t tsNano; };
+
+// The decoders only accept timestamps whose nanosecond count fits an int64_t, so
+// DaoOrigNs cannot overflow on whatever a sender puts on the wire.
+inline bool DaoTimestampFits(uint64_t secs, uint64_t nanos) {
+  return nanos < 1000000000 && secs <= ((uint64_t)INT64_MAX - nanos) / 1000000000;
+}
+
+// Origin timestamp of a decoded DAO, in nanoseconds.
+inline int64_t DaoOrigNs(const DaoPayload &p) { return (int64_t)p.tsSeconds * 1000000000 + (int64_t)p.tsNano; }
+
+// Legacy text encoding "DAO:seq:sec:nano", written into buf (kDaoMaxTextSize bytes)
+// without allocating; returns the encoded length.
+const uint32_t kDaoMaxTextSize = 4 + 10 + 1 + 20 + 1 + 20;
+
+inline uint32_t SerializeDaoText(const DaoPayload &p, char *buf) {
+  char *end = buf + kDaoMaxTextSize;
+  std::memcpy(buf, "DAO:", 4);
+  char *b = std::to_chars(buf + 4, end, p.seq).ptr;
+  *b++ = ':';
+  b = std::to_chars(b, end, p.tsSeconds).ptr;
+  *b++ = ':';
+  b = std::to_chars(b, end, p.tsNano).ptr;
+  return b - buf;
+}
+
+inline std::string SerializeDao(const DaoPayload &p) {
+  char buf[kDaoMaxTextSize];
+  return std::string(buf, SerializeDaoText(p, buf));
+}
+
+// Parses the text encoding in place. Each field is ':'-terminated (the last one by
+// ':' or the end) and must start with a decimal number; anything after the number
+// within the field is ignored.
+inline bool DeserializeDaoText(const char *s, uint32_t len, DaoPayload &out) {
+  const char *end = s + len;
+  if (len < 4 || std::memcmp(s, "DAO:", 4) != 0) return false;
+  const char *b = s + 4;
+  auto field = [&b, end](auto &v) {
+    auto res = std::from_chars(b, end, v);
+    if (res.ec != std::errc()) return false;
+    b = std::find(res.ptr, end, ':');
+    if (b != end) ++b;
+    return true;
+  };
+  uint32_t seq;
+  uint64_t secs, nanos;
+  if (!field(seq) || b == end || !field(secs) || b == end || !field(nanos)) return false;
+  if (!DaoTimestampFits(secs, nanos)) return false;
+  out.seq = seq;
+  out.tsSeconds = secs;
+  out.tsNano = nanos;
+  return true;
+}
+
+inline bool DeserializeDao(const std::string &s, DaoPayload &out) { return DeserializeDaoText(s.data(), s.size(), out); }
+
+// Binary DAO wire format (network byte order, 24 bytes):
+//   [0..1] magic 0xDA 0x0A   [2] version   [3] flags
+//   [4..7] seq               [8..15] tsSeconds   [16..23] tsNano
+//   [24..27] origin id       (only with kDaoFlagOrigin, 28 bytes in all)
+// The magic never collides with the text codec, whose first byte is 'D'.
+enum class DaoWireFormat { Text, Binary };
+
+const uint8_t kDaoMagic0 = 0xDA;
+const uint8_t kDaoMagic1 = 0x0A;
+const uint8_t kDaoVersion = 1;
+const uint32_t kDaoBinarySize = 24;
+const uint8_t kDaoFlagOrigin = 0x01;                    // logical sensor behind an aggregate sender
+const uint32_t kDaoOriginSize = kDaoBinarySize + 4;
+const uint32_t kDaoMaxWireSize = 64; // worst-case text encoding is kDaoMaxTextSize (56) bytes
+static_assert(kDaoMaxTextSize <= kDaoMaxWireSize, "text DAOs must fit a wire buffer");
+
+inline void PutU32(uint8_t *b, uint32_t v) {
+  b[0] = v >> 24; b[1] = v >> 16; b[2] = v >> 8; b[3] = v;
+}
+inline void PutU64(uint8_t *b, uint64_t v) {
+  PutU32(b, (uint32_t)(v >> 32)); PutU32(b + 4, (uint32_t)v);
+}
+inline uint32_t GetU32(const uint8_t *b) {
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3];
+}
+inline uint64_t GetU64(const uint8_t *b) {
+  return ((uint64_t)GetU32(b) << 32) | GetU32(b + 4);
+}
+
+// Writes kDaoBinarySize bytes into buf and returns the encoded length.
+inline uint32_t SerializeDaoBinary(const DaoPayload &p, uint8_t *buf) {
+  buf[0] = kDaoMagic0; buf[1] = kDaoMagic1; buf[2] = kDaoVersion; buf[3] = 0;
+  PutU32(buf + 4, p.seq);
+  PutU64(buf + 8, p.tsSeconds);
+  PutU64(buf + 16, p.tsNano);
+  return kDaoBinarySize;
+}
+
+// Same, tagged with a logical sensor's origin id; writes kDaoOriginSize bytes.
+inline uint32_t SerializeDaoBinary(const DaoPayload &p, uint32_t origin, uint8_t *buf) {
+  SerializeDaoBinary(p, buf);
+  buf[3] = kDaoFlagOrigin;
+  PutU32(buf + kDaoBinarySize, origin);
+  return kDaoOriginSize;
+}
+
+// No allocation, no exceptions: a wrong length, magic or version, or a timestamp
+// out of range, is just a decode failure.
+inline bool DeserializeDaoBinary(const uint8_t *buf, uint32_t len, DaoPayload &out) {
+  if (len < kDaoBinarySize || buf[0] != kDaoMagic0 || buf[1] != kDaoMagic1 || buf[2] != kDaoVersion)
+    return false;
+  if (len != (buf[3] & kDaoFlagOrigin ? kDaoOriginSize : kDaoBinarySize)) return false;
+  out.seq = GetU32(buf + 4);
+  out.tsSeconds = GetU64(buf + 8);
+  out.tsNano = GetU64(buf + 16);
+  return DaoTimestampFits(out.tsSeconds, out.tsNano);
+}
+
+// Decodes either wire format, dispatching on the leading magic byte.
+inline bool DeserializeDao(const uint8_t *buf, uint32_t len, DaoPayload &out) {
+  if (len > 0 && buf[0] == kDaoMagic0) return DeserializeDaoBinary(buf, len, out);
+  return DeserializeDaoText((const char *)buf, len, out);
+}
+
+inline bool ParseWireFormat(const std::string &name, DaoWireFormat &out) {
+  if (name == "binary") { out = DaoWireFormat::Binary; return true; }
+  if (name == "text") { out = DaoWireFormat::Text; return true; }
+  return false;
+}
+
+// ---------------------- Payload buffer pool ------------------------------
+// Fixed-size kDaoMaxWireSize blocks for DAO payloads the apps of one node encode or
+// keep (captures), carved from slabs of kSlabBlocks and recycled through an
+// intrusive free list. Acquire only allocates when the free list is empty, so once
+// a node's working set is in the pool, payload handling allocates nothing; the
+// counters let a run confirm that. A Block returns itself to the pool when
+// destroyed, and the pool must outlive its blocks. Single-threaded, like a node.
+struct DaoPoolStats {
+  uint64_t acquires = 0;   // blocks handed out
+  uint64_t releases = 0;   // blocks returned
+  uint64_t slabs = 0;      // heap allocations (one per slab)
+  uint64_t blocks = 0;     // blocks in those slabs
+  uint64_t peakInUse = 0;  // most blocks out at once (added pools: the largest peak)
+
+  void Add(const DaoPoolStats &o) {
+    acquires += o.acquires; releases += o.releases; slabs += o.slabs; blocks += o.blocks;
+    peakInUse = std::max(peakInUse, o.peakInUse);
+  }
+};
+
+class DaoPayloadPool {
+  union Node {
+    Node *next;
+    uint8_t bytes[kDaoMaxWireSize];
+  };
+
+public:
+  static constexpr uint32_t kSlabBlocks = 64;
+
+  class Block {
+  public:
+    Block() : m_pool(nullptr), m_node(nullptr), m_len(0) {}
+    Block(Block &&o) noexcept : m_pool(o.m_pool), m_node(o.m_node), m_len(o.m_len) { o.m_pool = nullptr; o.m_node = nullptr; }
+    Block &operator=(Block &&o) noexcept {
+      if (this != &o) {
+        Reset();
+        std::swap(m_pool, o.m_pool);
+        std::swap(m_node, o.m_node);
+        m_len = o.m_len;
+      }
+      return *this;
+    }
+    Block(const Block &) = delete;
+    Block &operator=(const Block &) = delete;
+    ~Block() { Reset(); }
+
+    explicit operator bool() const { return m_node != nullptr; }
+    uint8_t *Data() { return m_node->bytes; }
+    const uint8_t *Data() const { return m_node->bytes; }
+    // Bytes in use, set by the owner; at most kDaoMaxWireSize.
+    uint32_t Size() const { return m_len; }
+    void SetSize(uint32_t len) { m_len = std::min(len, kDaoMaxWireSize); }
+
+    void Reset() {
+      if (m_node) m_pool->Release(m_node);
+      m_pool = nullptr;
+      m_node = nullptr;
+      m_len = 0;
+    }
+
+  private:
+    friend class DaoPayloadPool;
+    Block(DaoPayloadPool *pool, Node *node) : m_pool(pool), m_node(node), m_len(0) {}
+    DaoPayloadPool *m_pool;
+    Node *m_node;
+    uint32_t m_len;
+  };
+
+  DaoPayloadPool() : m_free(nullptr), m_inUse(0) {}
+  DaoPayloadPool(const DaoPayloadPool &) = delete;
+  DaoPayloadPool &operator=(const DaoPayloadPool &) = delete;
+
+  Block Acquire() {
+    if (!m_free) Grow();
+    Node *node = m_free;
+    m_free = node->next;
+    ++m_stats.acquires;
+    m_stats.peakInUse = std::max<uint64_t>(m_stats.peakInUse, ++m_inUse);
+    return Block(this, node);
+  }
+
+  const DaoPoolStats &Stats() const { return m_stats; }
+
+private:
+  void Grow() {
+    m_slabs.emplace_back(new Node[kSlabBlocks]);
+    Node *slab = m_slabs.back().get();
+    for (uint32_t i = 0; i < kSlabBlocks; ++i) slab[i].next = i + 1 < kSlabBlocks ? &slab[i + 1] : m_free;
+    m_free = slab;
+    ++m_stats.slabs;
+    m_stats.blocks += kSlabBlocks;
+  }
+
+  void Release(Node *node) {
+    node->next = m_free;
+    m_free = node;
+    ++m_stats.releases;
+    --m_inUse;
+  }
+
+  std::vector<std::unique_ptr<Node[]>> m_slabs;
+  Node *m_free;
+  uint64_t m_inUse;
+  DaoPoolStats m_stats;
+};
+
+// Writes all of data to fd, retrying short writes and EINTR.
+inline bool WriteAll(int fd, const std::string &data) {
+  size_t off = 0;
+  while (off < data.size()) {
+    ssize_t n = write(fd, data.data() + off, data.size() - off);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    off += n;
+  }
+  return true;
+}
+
+// ---------------------- State snapshots ----------------------------------
+// Binary image of a root's anti-replay state and counters, so a long run can be
+// saved at some time and resumed or forked from there. The magic "DAOSNPv1" and a
+// byte-order mark, then each owner's fields in the order it saves them: scalars and
+// trivially copyable records as they are in memory, arrays as a u64 element count
+// and the raw elements, everything padded to 8 bytes. The file is only meant to be
+// read back by the same build on the same architecture. A reader mmap()s it and
+// copies every array out with one memcpy, so loading costs about one pass over
+// the table.
+const char kSnapshotMagic[8] = {'D', 'A', 'O', 'S', 'N', 'P', 'v', '1'};
+const uint32_t kSnapshotByteOrder = 0x01020304;
+
+class DaoSnapshotWriter {
+public:
+  DaoSnapshotWriter() {
+    m_data.append(kSnapshotMagic, sizeof(kSnapshotMagic));
+    Put(kSnapshotByteOrder);
+  }
+
+  template <class T>
+  void Put(const T &v) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot fields are raw copies");
+    m_data.append((const char *)&v, sizeof(T));
+    Pad();
+  }
+  template <class T>
+  void PutArray(const T *v, uint64_t n) {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshot fields are raw copies");
+    Put(n);
+    m_data.append((const char *)v, n * sizeof(T));
+    Pad();
+  }
+  template <class T>
+  void PutArray(const std::vector<T> &v) { PutArray(v.data(), v.size()); }
+  void PutString(const std::string &s) { PutArray(s.data(), s.size()); }
+
+  size_t Size() const { return m_data.size(); }
+
+  // Written to <path>.tmp.<pid> and rename()d over path, so a reader never sees a
+  // partial snapshot.
+  bool WriteFile(const std::string &path) const {
+    std::string tmp = path + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = WriteAll(fd, m_data);
+    ok = close(fd) == 0 && ok;
+    if (ok && rename(tmp.c_str(), path.c_str()) == 0) return true;
+    unlink(tmp.c_str());
+    return false;
+  }
+
+private:
+  void Pad() { m_data.resize((m_data.size() + 7) & ~(size_t)7, '\0'); }
+
+  std::string m_data;
+};
+
+// Reads a snapshot in the order it was written. Every Get fails, once the first
+// one has (truncated or mismatched file), and Error says why.
+class DaoSnapshotReader {
+public:
+  DaoSnapshotReader() : m_map(nullptr), m_size(0), m_pos(0) {}
+  ~DaoSnapshotReader() {
+    if (m_map) munmap(m_map, m_size);
+  }
+  DaoSnapshotReader(const DaoSnapshotReader &) = delete;
+  DaoSnapshotReader &operator=(const DaoSnapshotReader &) = delete;
+
+  bool Open(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return Fail("cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED) {
+        m_map = map;
+        m_size = st.st_size;
+      }
+    }
+    close(fd);
+    if (!m_map) return Fail("cannot map " + path);
+    uint32_t order = 0;
+    if (m_size < sizeof(kSnapshotMagic) || std::memcmp(m_map, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+      return Fail(path + " is not a DAO snapshot");
+    }
+    m_pos = sizeof(kSnapshotMagic);
+    if (!Get(order) || order != kSnapshotByteOrder) return Fail(path + " was written on another architecture");
+    return true;
+  }
+
+  template <class T>
+  bool Get(T &v) {
+    if (!Take(sizeof(T))) return false;
+    std::memcpy(&v, Data() - sizeof(T), sizeof(T));
+    return Skip();
+  }
+  template <class T>
+  bool GetArray(std::vector<T> &v) {
+    uint64_t n;
+    if (!Get(n)) return false;
+    if (n > (m_size - m_pos) / sizeof(T)) return Fail("truncated snapshot");
+    v.resize(n);
+    Take(n * sizeof(T));
+    if (n) std::memcpy(v.data(), Data() - n * sizeof(T), n * sizeof(T));
+    return Skip();
+  }
+  bool GetString(std::string &s) {
+    std::vector<char> v;
+    if (!GetArray(v)) return false;
+    s.assign(v.begin(), v.end());
+    return true;
+  }
+
+  bool AtEnd() const { return m_error.empty() && m_pos == m_size; }
+  bool Fail(const std::string &why) {
+    if (m_error.empty()) m_error = why;
+    return false;
+  }
+  const std::string &Error() const { return m_error; }
+
+private:
+  const uint8_t *Data() const { return (const uint8_t *)m_map + m_pos; }
+  bool Take(size_t n) {
+    if (!m_error.empty()) return false;
+    if (n > m_size - m_pos) return Fail("truncated snapshot");
+    m_pos += n;
+    return true;
+  }
+  bool Skip() {
+    m_pos = std::min((m_pos + 7) & ~(size_t)7, m_size);
+    return m_error.empty();
+  }
+
+  void *m_map;
+  size_t m_size;
+  size_t m_pos;
+  std::string m_error;
+};
+
+// ---------------------- Streaming statistics ------------------------------
+// Welford running mean/variance plus min/max: O(1) memory however many samples arrive.
+struct RunningStats {
+  uint64_t count = 0;
+  double mean = 0.0;
+  double m2 = 0.0;
+  double min = 0.0;
+  double max = 0.0;
+
+  void Add(double x) {
+    if (count == 0) { min = max = x; }
+    else { min = std::min(min, x); max = std::max(max, x); }
+    ++count;
+    double d = x - mean;
+    mean += d / (double)count;
+    m2 += d * (x - mean);
+  }
+
+  double Variance() const { return count > 1 ? m2 / (double)(count - 1) : 0.0; }
+  double StdDev() const { return std::sqrt(Variance()); }
+
+  // Folds in another accumulator (Chan et al. pairwise update).
+  void Merge(const RunningStats &o) {
+    if (o.count == 0) return;
+    if (count == 0) { *this = o; return; }
+    uint64_t n = count + o.count;
+    double d = o.mean - mean;
+    mean += d * (double)o.count / (double)n;
+    m2 += o.m2 + d * d * (double)count * (double)o.count / (double)n;
+    min = std::min(min, o.min);
+    max = std::max(max, o.max);
+    count = n;
+  }
+};
+
+// Fixed-size log-bucketed histogram over non-negative integer samples (nanoseconds).
+// Each power-of-two octave is split into kSub linear sub-buckets, so a quantile is
+// reported within 1/kSub relative error using a constant 496 counters.
+class LogHistogram {
+public:
+  static constexpr uint32_t kSubBits = 3;
+  static constexpr uint32_t kSub = 1u << kSubBits;
+  static constexpr uint32_t kBuckets = (64 - kSubBits + 1) * kSub;
+
+  LogHistogram() : m_total(0) { std::fill(m_counts, m_counts + kBuckets, 0); }
+
+  void Add(uint64_t v) { ++m_counts[Index(v)]; ++m_total; }
+  uint64_t Count() const { return m_total; }
+
+  void Merge(const LogHistogram &o) {
+    for (uint32_t i = 0; i < kBuckets; ++i) m_counts[i] += o.m_counts[i];
+    m_total += o.m_total;
+  }
+
+  void Save(DaoSnapshotWriter &w) const {
+    w.Put(m_counts);
+    w.Put(m_total);
+  }
+  bool Load(DaoSnapshotReader &r) { return r.Get(m_counts) && r.Get(m_total); }
+
+  // Midpoint of the bucket holding the q-quantile (0 <= q <= 1); 0 when empty.
+  double Quantile(double q) const {
+    if (m_total == 0) return 0.0;
+    uint64_t rank = (uint64_t)(q * (double)(m_total - 1));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+      seen += m_counts[i];
+      if (seen > rank) return (double)Lower(i) + (double)Width(i) / 2.0;
+    }
+    return (double)Lower(kBuckets - 1);
+  }
+
+private:
+  static uint32_t Index(uint64_t v) {
+    if (v < kSub) return (uint32_t)v;
+    uint32_t octave = 63 - __builtin_clzll(v);
+    uint32_t sub = (uint32_t)(v >> (octave - kSubBits)) & (kSub - 1);
+    return (octave - kSubBits + 1) * kSub + sub;
+  }
+  static uint64_t Lower(uint32_t i) {
+    if (i < kSub) return i;
+    uint32_t octave = i / kSub + kSubBits - 1;
+    return (uint64_t)(kSub + i % kSub) << (octave - kSubBits);
+  }
+  static uint64_t Width(uint32_t i) {
+    return i < kSub ? 1 : 1ULL << (i / kSub - 1);
+  }
+
+  uint64_t m_counts[kBuckets];
+  uint64_t m_total;
+};
+
+// Wall-clock cost of one processing stage. steady_clock is vDSO-backed on Linux
+// (tens of ns per read), cheap enough to bracket every packet when enabled.
+inline int64_t WallClockNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct StageCost {
+  RunningStats ns;
+  LogHistogram hist;
+
+  void Add(int64_t d) {
+    if (d < 0) d = 0;
+    ns.Add((double)d);
+    hist.Add((uint64_t)d);
+  }
+  double Quantile(double q) const {
+    return ns.count ? std::min(std::max(hist.Quantile(q), ns.min), ns.max) : 0.0;
+  }
+};
+
+// ---------------------- Per-sender state table ----------------------------
+// One flat record per sender holds both the anti-replay state and the metrics, so a
+// single hash probe per packet serves CheckFresh and the inter-arrival bookkeeping.
+// Times are plain nanosecond counts to keep the record trivially copyable.
+struct DaoSenderKey { uint8_t addr[16]; };
+
+// RFC 5952 text form of a sender's address.
+inline std::string FormatSenderKey(const DaoSenderKey &key) {
+  char buf[INET6_ADDRSTRLEN];
+  return inet_ntop(AF_INET6, key.addr, buf, sizeof(buf)) ? buf : "?";
+}
+
+// Logical sensors sharing one node (DaoAggregateSenderApp) are told apart by the
+// origin id of a kDaoFlagOrigin datagram: it replaces the low 32 bits of the
+// source address in the key, as if each sensor had its own address in the
+// node's /64. Other datagrams leave the key alone.
+inline void ApplyDaoOrigin(const uint8_t *wire, uint32_t len, DaoSenderKey &key) {
+  if (len == kDaoOriginSize && wire[0] == kDaoMagic0 && wire[1] == kDaoMagic1 && (wire[3] & kDaoFlagOrigin)) {
+    std::memcpy(key.addr + 12, wire + kDaoBinarySize, 4);
+  }
+}
+
+// What a bounded table remembers about the senders it evicts:
+//   fresh-ts: per hash bucket, the newest accepted origin timestamp of any evicted
+//             sender heard more than once, capped at its last arrival time; a sender
+//             (re)entering through that bucket must beat it, so replaying an evicted
+//             sender's old DAOs does not pass as first contact;
+//   forget:   nothing; an evicted sender starts over as on first contact.
+enum class DaoEvictPolicy { FreshTimestamp, Forget };
+
+inline bool ParseEvictPolicy(const std::string &name, DaoEvictPolicy &out) {
+  if (name == "fresh-ts") { out = DaoEvictPolicy::FreshTimestamp; return true; }
+  if (name == "forget") { out = DaoEvictPolicy::Forget; return true; }
+  return false;
+}
+
+const int64_t kNoOrigFloor = INT64_MIN;
+
+// Outcome of judging one DAO: Accept, or the check that rejected it. The counters
+// indexed by verdict replace per-reason debug logging.
+enum class DaoVerdict : uint8_t {
+  Accept,
+  EvictedFloor,  // origTs not newer than an evicted sender's (fresh-ts)
+  SeqOlder,      // seq < lastSeq
+  RepeatedSeqTs, // same seq and identical origTs as the last accepted DAO
+  TsOlder,       // origTs older than the last accepted one
+  Burst,         // repeated seq arriving within the threshold of the last accept
+  WindowStale,   // seq behind the replay window
+  WindowSeen,    // seq already seen in the replay window
+  Duplicate,     // exact copy of a recently accepted datagram (DupPayloadCache)
+};
+const uint32_t kDaoVerdicts = (uint32_t)DaoVerdict::Duplicate + 1;
+
+inline const char *VerdictName(DaoVerdict v) {
+  static const char *const names[kDaoVerdicts] = {"accept", "evicted_floor", "seq_older", "repeated_seq_ts", "ts_older",
+                                                  "burst", "window_stale", "window_seen", "duplicate"};
+  return names[(uint32_t)v];
+}
+
+struct SenderState {
+  bool hasAccepted;            // lastSeq/lastOrigNs/lastArrivalNs are valid
+  uint32_t lastSeq;
+  int64_t lastOrigNs;          // origin timestamp of the last accepted DAO
+  int64_t lastArrivalNs;       // arrival time of the last accepted DAO (burst window)
+  int64_t prevArrivalNs;       // arrival time of the last DAO of any verdict
+  RunningStats interArrival;   // seconds between consecutive DAOs of any verdict
+  uint32_t sampleDaos;         // DAOs since the last time-series sample
+  uint32_t logAccepted;        // verdicts since the last summary log line
+  uint32_t logRejected;
+  int64_t floorOrigNs;         // origin timestamps must exceed this (see DaoEvictPolicy)
+  uint32_t verdicts[kDaoVerdicts]; // DAOs per verdict over the sender's lifetime in the table
+};
+
+// Open-addressing (linear probing) index over a dense SenderState array. Slots are
+// assigned in order of first contact and never move, so callers may cache them.
+// With a capacity set, the table stops growing once full and recycles the slot of
+// a CLOCK victim instead: a hit sets the slot's reference bit, the hand clears bits
+// until it finds an unreferenced slot. New senders start unreferenced, so a flood
+// of one-shot (spoofed) sources is evicted before senders heard from repeatedly.
+// A recycled slot's state is reset, so a cached slot is only valid until the next
+// insert.
+class SenderTable {
+public:
+  SenderTable()
+    : m_mask(0), m_capacity(0), m_hand(0), m_evictions(0)
+  {
+    Rehash(64);
+  }
+
+  // Bounds the table to capacity senders (0 = unbounded). Call before the first insert.
+  void SetCapacity(uint32_t capacity, DaoEvictPolicy policy) {
+    m_capacity = capacity;
+    if (capacity == 0) return;
+    uint32_t buckets = 64;
+    while (buckets < 2 * (uint64_t)capacity) buckets <<= 1;
+    Rehash(buckets);
+    m_keys.reserve(capacity);
+    m_states.reserve(capacity);
+    m_ref.assign(capacity, 0);
+    if (policy == DaoEvictPolicy::FreshTimestamp) m_floors.assign(buckets / 2, kNoOrigFloor);
+  }
+
+  // Returns the slot for key, assigning the next dense slot (or, when full, an
+  // evicted one) on first contact.
+  uint32_t FindOrInsert(const DaoSenderKey &key, bool &inserted) {
+    for (uint32_t b = Hash(key) & m_mask;; b = (b + 1) & m_mask) {
+      uint32_t slot = m_index[b];
+      if (slot == kEmpty) break;
+      if (std::memcmp(m_keys[slot].addr, key.addr, sizeof(key.addr)) == 0) {
+        if (m_capacity) m_ref[slot] = 1;
+        inserted = false;
+        return slot;
+      }
+    }
+    uint32_t slot;
+    if (m_capacity && m_keys.size() == m_capacity) {
+      slot = Evict();
+      m_keys[slot] = key;
+      m_states[slot] = SenderState();
+    } else {
+      if ((m_keys.size() + 1) * 2 > m_index.size()) Rehash(m_index.size() * 2);
+      slot = m_keys.size();
+      m_keys.push_back(key);
+      m_states.emplace_back();
+    }
+    SenderState &st = m_states[slot];
+    st.hasAccepted = false;
+    st.floorOrigNs = m_floors.empty() ? kNoOrigFloor : m_floors[FloorOf(key)];
+    Place(slot);
+    inserted = true;
+    return slot;
+  }
+
+  // Lookup without inserting or touching the reference bit.
+  bool Find(const DaoSenderKey &key, uint32_t &slot) const {
+    for (uint32_t b = Hash(key) & m_mask;; b = (b + 1) & m_mask) {
+      slot = m_index[b];
+      if (slot == kEmpty) return false;
+      if (std::memcmp(m_keys[slot].addr, key.addr, sizeof(key.addr)) == 0) return true;
+    }
+  }
+
+  SenderState &At(uint32_t slot) { return m_states[slot]; }
+  const SenderState &At(uint32_t slot) const { return m_states[slot]; }
+  const DaoSenderKey &KeyAt(uint32_t slot) const { return m_keys[slot]; }
+  uint32_t Size() const { return m_keys.size(); }
+  uint32_t Capacity() const { return m_capacity; }
+  uint64_t Evictions() const { return m_evictions; }
+
+  // The whole table, index included, so a loaded table needs no rehash. Capacity
+  // and eviction policy come with it.
+  void Save(DaoSnapshotWriter &w) const {
+    w.Put(m_mask);
+    w.Put(m_capacity);
+    w.Put(m_hand);
+    w.Put(m_evictions);
+    w.PutArray(m_index);
+    w.PutArray(m_keys);
+    w.PutArray(m_states);
+    w.PutArray(m_ref);
+    w.PutArray(m_floors);
+  }
+
+  bool Load(DaoSnapshotReader &r) {
+    if (!(r.Get(m_mask) && r.Get(m_capacity) && r.Get(m_hand) && r.Get(m_evictions) && r.GetArray(m_index) &&
+          r.GetArray(m_keys) && r.GetArray(m_states) && r.GetArray(m_ref) && r.GetArray(m_floors))) {
+      return false;
+    }
+    bool ok = m_index.size() == (size_t)m_mask + 1 && (m_mask & (m_mask + 1)) == 0 &&
+              m_keys.size() == m_states.size() && m_keys.size() * 2 <= m_index.size() &&
+              m_ref.size() == m_capacity && (m_capacity == 0 || (m_keys.size() <= m_capacity && m_hand < m_capacity));
+    for (uint32_t slot : m_index) ok = ok && (slot == kEmpty || slot < m_keys.size());
+    if (!ok) return r.Fail("inconsistent sender table in snapshot");
+    m_keys.reserve(m_capacity);
+    m_states.reserve(m_capacity);
+    return true;
+  }
+
+private:
+  static constexpr uint32_t kEmpty = 0xffffffffu;
+
+  static uint32_t Hash(const DaoSenderKey &key) {
+    uint64_t lo, hi;
+    std::memcpy(&lo, key.addr, 8);
+    std::memcpy(&hi, key.addr + 8, 8);
+    // Full 64-bit finalizer: the builder's addresses differ only in bytes 4-7 (the
+    // link index, big-endian), which a single multiply leaves out of the low bits.
+    uint64_t h = lo ^ (hi * 0x9e3779b97f4a7c15ULL);
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+    h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    return (uint32_t)(h ^ (h >> 33));
+  }
+
+  void Place(uint32_t slot) {
+    uint32_t b = Hash(m_keys[slot]) & m_mask;
+    while (m_index[b] != kEmpty) b = (b + 1) & m_mask;
+    m_index[b] = slot;
+  }
+
+  void Rehash(uint32_t buckets) {
+    m_index.assign(buckets, kEmpty);
+    m_mask = buckets - 1;
+    for (uint32_t slot = 0; slot < m_keys.size(); ++slot) Place(slot);
+  }
+
+  static uint64_t Heard(const SenderState &st) {
+    uint64_t n = 0;
+    for (uint32_t v = 0; v < kDaoVerdicts; ++v) n += st.verdicts[v];
+    return n;
+  }
+
+  // Floor buckets use the hash's high bits, independent of the index position.
+  uint32_t FloorOf(const DaoSenderKey &key) const {
+    return (uint32_t)(((uint64_t)Hash(key) * m_floors.size()) >> 32);
+  }
+
+  // Advances the CLOCK hand to an unreferenced slot and unlinks it from the index.
+  uint32_t Evict() {
+    while (m_ref[m_hand]) {
+      m_ref[m_hand] = 0;
+      m_hand = m_hand + 1 == m_capacity ? 0 : m_hand + 1;
+    }
+    uint32_t victim = m_hand;
+    m_hand = m_hand + 1 == m_capacity ? 0 : m_hand + 1;
+    // A floor is shared by a whole bucket, so only senders heard more than once
+    // raise it (a one-shot spoofed source would lock out every honest sender in its
+    // bucket), and by no more than their last arrival time, since a sender picks its
+    // own origin timestamps and could stamp them far in the future.
+    const SenderState &st = m_states[victim];
+    if (!m_floors.empty() && st.hasAccepted && Heard(st) > 1) {
+      int64_t &floor = m_floors[FloorOf(m_keys[victim])];
+      floor = std::max(floor, std::min(st.lastOrigNs, st.lastArrivalNs));
+    }
+    Unplace(victim);
+    ++m_evictions;
+    return victim;
+  }
+
+  // Linear-probing delete by backward shift: later entries of the probe run move
+  // into the hole unless their home bucket lies after it, so lookups stay exact.
+  void Unplace(uint32_t slot) {
+    uint32_t b = Hash(m_keys[slot]) & m_mask;
+    while (m_index[b] != slot) b = (b + 1) & m_mask;
+    m_index[b] = kEmpty;
+    for (uint32_t j = (b + 1) & m_mask; m_index[j] != kEmpty; j = (j + 1) & m_mask) {
+      uint32_t home = Hash(m_keys[m_index[j]]) & m_mask;
+      if (((j - home) & m_mask) >= ((j - b) & m_mask)) {
+        m_index[b] = m_index[j];
+        m_index[j] = kEmpty;
+        b = j;
+      }
+    }
+  }
+
+  std::vector<uint32_t> m_index;   // bucket -> slot, kEmpty when unused
+  std::vector<DaoSenderKey> m_keys;
+  std::vector<SenderState> m_states;
+  uint32_t m_mask;
+
+  // Bounded mode (m_capacity > 0)
+  uint32_t m_capacity;
+  uint32_t m_hand;                 // CLOCK hand over slots
+  uint64_t m_evictions;
+  std::vector<uint8_t> m_ref;      // CLOCK reference bits, per slot
+  std::vector<int64_t> m_floors;   // fresh-ts: newest (clamped) origin timestamp evicted per bucket
+};
+
+// ---------------------- Freshness policies --------------------------------
+// Freshness checks are small policy classes composed at compile time by
+// FreshnessChain. Every part exposes
+//   DaoVerdict Check(slot, st, p, origNs, arrivalNs) -- read-only verdict
+//   void Accept(slot, st, p)                         -- per-part state update on accept
+//   static constexpr DaoVerdict kRepeatVerdict       -- its verdict on a byte-identical
+//                                                       repeat of the newest accepted
+//                                                       DAO, whatever the arrival time
+//                                                       (Accept if not always rejected)
+//   void Save(w) / bool Load(r)                      -- its own per-sender state, for
+//                                                       snapshots
+// and the chain only calls Accept once every part has passed, so a part that
+// rejects never leaves another part's state half-updated. Parts needing extra
+// per-sender state keep it in their own dense array indexed by SenderTable slot.
+
+// Rejects sequences older than the last accepted one.
+struct SeqPolicy {
+  static constexpr DaoVerdict kRepeatVerdict = DaoVerdict::Accept;
+  DaoVerdict Check(uint32_t, const SenderState &st, const DaoPayload &p, int64_t, int64_t) const {
+    return st.hasAccepted && p.seq < st.lastSeq ? DaoVerdict::SeqOlder : DaoVerdict::Accept;
+  }
+  void Accept(uint32_t, const SenderState &, const DaoPayload &) {}
+  void Save(DaoSnapshotWriter &) const {}
+  bool Load(DaoSnapshotReader &) { return true; }
+};
+
+// Rejects a repeated (seq, origTs) pair and origin timestamps older than the last accepted one.
+struct TimestampPolicy {
+  static constexpr DaoVerdict kRepeatVerdict = DaoVerdict::RepeatedSeqTs;
+  DaoVerdict Check(uint32_t, const SenderState &st, const DaoPayload &p, int64_t origNs, int64_t) const {
+    if (!st.hasAccepted) return DaoVerdict::Accept;
+    if (p.seq == st.lastSeq && origNs == st.lastOrigNs) return DaoVerdict::RepeatedSeqTs;
+    if (origNs < st.lastOrigNs) return DaoVerdict::TsOlder;
+    return DaoVerdict::Accept;
+  }
+  void Accept(uint32_t, const SenderState &, const DaoPayload &) {}
+  void Save(DaoSnapshotWriter &) const {}
+  bool Load(DaoSnapshotReader &) { return true; }
+};
+
+// Rejects a repeated sequence arriving within the threshold of the last accepted DAO.
+class BurstPolicy {
+public:
+  static constexpr DaoVerdict kRepeatVerdict = DaoVerdict::Accept;
+  explicit BurstPolicy(int64_t thresholdNs) : m_threshNs(thresholdNs) {}
+
+  DaoVerdict Check(uint32_t, const SenderState &st, const DaoPayload &p, int64_t, int64_t arrivalNs) const {
+    bool burst = st.hasAccepted && p.seq == st.lastSeq && arrivalNs - st.lastArrivalNs < m_threshNs;
+    return burst ? DaoVerdict::Burst : DaoVerdict::Accept;
+  }
+  void Accept(uint32_t, const SenderState &, const DaoPayload &) {}
+  void Save(DaoSnapshotWriter &) const {}
+  bool Load(DaoSnapshotReader &) { return true; }
+
+private:
+  int64_t m_threshNs;
+};
+
+// IPsec-style anti-replay window (RFC 4303 semantics, RFC 6479 layout): accepts any
+// not-yet-seen sequence within Bits of the highest one, so legitimately reordered DAOs
+// pass while duplicates and stale sequences are rejected. The bitmap is a ring of
+// 64-bit words indexed by seq itself; one spare word lets advancing the window clear
+// whole words instead of shifting, so every check and update is a few bit operations.
+template <uint32_t Bits>
+class WindowPolicy {
+  static_assert(Bits % 64 == 0, "window size must be a multiple of 64");
+
+public:
+  static constexpr DaoVerdict kRepeatVerdict = DaoVerdict::WindowSeen;
+
+  DaoVerdict Check(uint32_t slot, const SenderState &st, const DaoPayload &p, int64_t, int64_t) const {
+    if (!st.hasAccepted) return DaoVerdict::Accept;
+    const Window &w = m_windows[slot];
+    uint64_t seq = p.seq;
+    if (seq > w.top) return DaoVerdict::Accept;
+    if (w.top - seq >= Bits) return DaoVerdict::WindowStale;
+    if (w.words[(seq >> 6) % kWords] & (1ULL << (seq & 63))) return DaoVerdict::WindowSeen;
+    return DaoVerdict::Accept;
+  }
+
+  void Accept(uint32_t slot, const SenderState &st, const DaoPayload &p) {
+    if (slot >= m_windows.size()) m_windows.resize(slot + 1);
+    Window &w = m_windows[slot];
+    uint64_t seq = p.seq;
+    if (!st.hasAccepted) {
+      std::fill(w.words, w.words + kWords, 0);
+      w.top = seq;
+    } else if (seq > w.top) {
+      uint64_t cur = w.top >> 6;
+      uint64_t steps = std::min<uint64_t>((seq >> 6) - cur, kWords);
+      for (uint64_t i = 1; i <= steps; ++i) w.words[(cur + i) % kWords] = 0;
+      w.top = seq;
+    }
+    w.words[(seq >> 6) % kWords] |= 1ULL << (seq & 63);
+  }
+
+  void Save(DaoSnapshotWriter &w) const { w.PutArray(m_windows); }
+  bool Load(DaoSnapshotReader &r) { return r.GetArray(m_windows); }
+
+private:
+  static constexpr uint32_t kWords = Bits / 64 + 1;
+  struct Window {
+    uint64_t top;          // highest accepted sequence
+    uint64_t words[kWords];
+  };
+
+  std::vector<Window> m_windows; // indexed by SenderTable slot
+};
+
+// Runtime boundary between the root and a chosen policy combination: one indirect
+// call per DAO, with the composed checks inlined behind it.
+class FreshnessPolicy {
+public:
+  virtual ~FreshnessPolicy() {}
+  virtual const char *Name() const = 0;
+  virtual DaoVerdict Check(uint32_t slot, SenderState &st, const DaoPayload &p, int64_t arrivalNs) = 0;
+  // The verdict on a byte-identical repeat of a sender's newest accepted DAO (highest
+  // seq and timestamp so far) if it is rejected whatever its arrival time, so callers
+  // may reject such repeats without decoding them; Accept otherwise.
+  virtual DaoVerdict RepeatVerdict() const = 0;
+  // Records p as accepted without judging it (state learned from another root).
+  // Returns false, changing nothing, unless p is ahead of the sender's state.
+  virtual bool Learn(uint32_t slot, SenderState &st, const DaoPayload &p) = 0;
+  // The parts' own state, in part order.
+  virtual void Save(DaoSnapshotWriter &w) const = 0;
+  virtual bool Load(DaoSnapshotReader &r) = 0;
+};
+
+template <class... Parts>
+class FreshnessChain final : public FreshnessPolicy {
+public:
+  explicit FreshnessChain(std::string name, Parts... parts) : m_name(std::move(name)), m_parts(std::move(parts)...) {}
+
+  const char *Name() const override { return m_name.c_str(); }
+  // The first part to reject a repeat decides, as in Check.
+  DaoVerdict RepeatVerdict() const override {
+    DaoVerdict v = DaoVerdict::Accept;
+    (void)(((v = Parts::kRepeatVerdict) == DaoVerdict::Accept) && ...);
+    return v;
+  }
+
+  DaoVerdict Check(uint32_t slot, SenderState &st, const DaoPayload &p, int64_t arrivalNs) override {
+    int64_t origNs = DaoOrigNs(p);
+    if (origNs <= st.floorOrigNs) return DaoVerdict::EvictedFloor;
+    // Folds left to right and stops at the first part that rejects.
+    DaoVerdict v = DaoVerdict::Accept;
+    std::apply([&](const Parts &...part) {
+      (void)(((v = part.Check(slot, st, p, origNs, arrivalNs)) == DaoVerdict::Accept) && ...);
+    }, m_parts);
+    if (v != DaoVerdict::Accept) return v;
+    std::apply([&](Parts &...part) { (part.Accept(slot, st, p), ...); }, m_parts);
+    // Windowed parts may accept out of order, so the shared state keeps the maxima.
+    st.lastSeq = st.hasAccepted ? std::max(st.lastSeq, p.seq) : p.seq;
+    st.lastOrigNs = st.hasAccepted ? std::max(st.lastOrigNs, origNs) : origNs;
+    st.lastArrivalNs = arrivalNs;
+    st.hasAccepted = true;
+    return DaoVerdict::Accept;
+  }
+
+  // Every part takes p as accepted; the burst window (lastArrivalNs) stays local.
+  bool Learn(uint32_t slot, SenderState &st, const DaoPayload &p) override {
+    int64_t origNs = DaoOrigNs(p);
+    if (st.hasAccepted && p.seq <= st.lastSeq && origNs <= st.lastOrigNs) return false;
+    std::apply([&](Parts &...part) { (part.Accept(slot, st, p), ...); }, m_parts);
+    st.lastSeq = st.hasAccepted ? std::max(st.lastSeq, p.seq) : p.seq;
+    st.lastOrigNs = st.hasAccepted ? std::max(st.lastOrigNs, origNs) : origNs;
+    st.hasAccepted = true;
+    return true;
+  }
+
+  void Save(DaoSnapshotWriter &w) const override {
+    std::apply([&](const Parts &...part) { (part.Save(w), ...); }, m_parts);
+  }
+  bool Load(DaoSnapshotReader &r) override {
+    return std::apply([&](Parts &...part) { return (part.Load(r) && ...); }, m_parts);
+  }
+
+private:
+  std::string m_name;
+  std::tuple<Parts...> m_parts;
+};
+
+// Selector helpers: append the optional parts, then instantiate the exact chain.
+template <class... Parts>
+std::unique_ptr<FreshnessPolicy> ChainWithBurst(const std::string &name, bool burst, int64_t thresholdNs, Parts... parts) {
+  if (burst) return std::make_unique<FreshnessChain<Parts..., BurstPolicy>>(name, parts..., BurstPolicy(thresholdNs));
+  return std::make_unique<FreshnessChain<Parts...>>(name, parts...);
+}
+
+template <class... Parts>
+std::unique_ptr<FreshnessPolicy> ChainWithTimestamp(const std::string &name, bool ts, bool burst, int64_t thresholdNs, Parts... parts) {
+  if (ts) return ChainWithBurst(name, burst, thresholdNs, parts..., TimestampPolicy());
+  return ChainWithBurst(name, burst, thresholdNs, parts...);
+}
+
+// Maps a --freshness spec to a policy chain; returns nullptr for an invalid spec.
+// The spec is a '+'-separated list of parts: at most one of seq, window64, window128,
+// window1024, plus optional ts and burst. "hybrid" is an alias for seq+ts+burst.
+inline std::unique_ptr<FreshnessPolicy> MakeFreshnessPolicy(const std::string &spec, int64_t thresholdNs) {
+  std::string parts = spec == "hybrid" ? "seq+ts+burst" : spec;
+  // getline yields no token after a trailing '+'; other empty parts fail below
+  if (!parts.empty() && parts.back() == '+') return nullptr;
+  uint32_t window = 0;
+  bool seq = false, ts = false, burst = false;
+  std::istringstream iss(parts);
+  std::string tok;
+  while (std::getline(iss, tok, '+')) {
+    bool haveBase = seq || window != 0;  // seq or a window part already given
+    if (tok == "seq" && !haveBase) seq = true;
+    else if (tok == "window64" && !haveBase) window = 64;
+    else if (tok == "window128" && !haveBase) window = 128;
+    else if (tok == "window1024" && !haveBase) window = 1024;
+    else if (tok == "ts" && !ts) ts = true;
+    else if (tok == "burst" && !burst) burst = true;
+    else return nullptr;
+  }
+  if (seq) return ChainWithTimestamp(spec, ts, burst, thresholdNs, SeqPolicy());
+  if (window == 64) return ChainWithTimestamp(spec, ts, burst, thresholdNs, WindowPolicy<64>());
+  if (window == 128) return ChainWithTimestamp(spec, ts, burst, thresholdNs, WindowPolicy<128>());
+  if (window == 1024) return ChainWithTimestamp(spec, ts, burst, thresholdNs, WindowPolicy<1024>());
+  if (!ts && !burst) return nullptr;
+  return ChainWithTimestamp(spec, ts, burst, thresholdNs);
+}
+
+// ---------------------- Metrics writer -----------------------------------
+// Every run emits one row: string tags identifying the run (scenario parameters,
+// seed, wall-clock timestamp) followed by numeric metrics. Rows are buffered and
+// written in a single write() on Flush:
+//   append:  shared file, flock()ed around the size check so the header is written
+//            exactly once and concurrent runs never interleave partial rows; a file
+//            whose header differs (other columns) is left alone and Flush fails;
+//   replace: the row goes to <path>.tmp.<pid> and is rename()d over path, so readers
+//            only ever see a complete file (used for per-run sweep outputs).
+// csv is one header line plus comma-separated rows. bin is compact and
+// self-describing: the magic "DAOMETv1", u32 tag count, u32 metric count, then each
+// column name as u16 length + bytes; every row is its tags (u16 length + bytes)
+// followed by its metrics as little-endian IEEE-754 doubles.
+enum class DaoMetricsFormat { Csv, Binary };
+enum class DaoMetricsMode { Append, Replace };
+
+inline bool ParseMetricsFormat(const std::string &name, DaoMetricsFormat &out) {
+  if (name == "csv") { out = DaoMetricsFormat::Csv; return true; }
+  if (name == "bin") { out = DaoMetricsFormat::Binary; return true; }
+  return false;
+}
+
+inline bool ParseMetricsMode(const std::string &name, DaoMetricsMode &out) {
+  if (name == "append") { out = DaoMetricsMode::Append; return true; }
+  if (name == "replace") { out = DaoMetricsMode::Replace; return true; }
+  return false;
+}
+
+struct DaoMetricsRow {
+  std::vector<std::pair<std::string, std::string>> tags;
+  std::vector<std::pair<std::string, double>> values;
+};
+
+const char kMetricsMagic[8] = {'D', 'A', 'O', 'M', 'E', 'T', 'v', '1'};
+
+class DaoMetricsWriter {
+public:
+  DaoMetricsWriter() : m_format(DaoMetricsFormat::Csv), m_mode(DaoMetricsMode::Append) {}
+
+  void Open(const std::string &path, DaoMetricsFormat format, DaoMetricsMode mode) {
+    m_path = path; m_format = format; m_mode = mode;
+  }
+
+  const std::string &GetPath() const { return m_path; }
+  // Why the last Flush failed.
+  const std::string &GetError() const { return m_error; }
+
+  // Buffers one row; all rows of a file must share the first row's columns.
+  void Add(const DaoMetricsRow &row) {
+    if (m_header.empty()) m_header = EncodeHeader(row);
+    if (m_format == DaoMetricsFormat::Csv) {
+      for (size_t i = 0; i < row.tags.size(); ++i) m_body += (i ? "," : "") + row.tags[i].second;
+      for (size_t i = 0; i < row.values.size(); ++i) {
+        std::ostringstream oss;
+        oss << std::setprecision(10) << row.values[i].second;
+        m_body += (i || !row.tags.empty() ? "," : "") + oss.str();
+      }
+      m_body += "\n";
+    } else {
+      for (const auto &t : row.tags) PutString(m_body, t.second);
+      for (const auto &v : row.values) {
+        uint64_t bits;
+        std::memcpy(&bits, &v.second, sizeof(bits));
+        for (int b = 0; b < 8; ++b) m_body.push_back((char)(bits >> (8 * b)));
+      }
+    }
+  }
+
+  bool Flush() {
+    if (m_body.empty()) return true;
+    bool ok = m_mode == DaoMetricsMode::Append ? FlushAppend() : FlushReplace();
+    if (ok) m_body.clear();
+    return ok;
+  }
+
+  // Length of the header at the start of an encoded metrics file (0 if none).
+  static size_t HeaderLength(const std::string &data, DaoMetricsFormat format) {
+    if (format == DaoMetricsFormat::Csv) {
+      size_t nl = data.find('\n');
+      return nl == std::string::npos ? data.size() : nl + 1;
+    }
+    if (data.size() < 16 || std::memcmp(data.data(), kMetricsMagic, 8) != 0) return 0;
+    auto u32 = [&data](size_t at) {
+      return (uint32_t)(uint8_t)data[at] | (uint32_t)(uint8_t)data[at + 1] << 8 |
+             (uint32_t)(uint8_t)data[at + 2] << 16 | (uint32_t)(uint8_t)data[at + 3] << 24;
+    };
+    size_t pos = 16;
+    uint64_t names = (uint64_t)u32(8) + u32(12);
+    for (uint64_t i = 0; i < names && pos + 2 <= data.size(); ++i) {
+      pos += 2 + ((uint8_t)data[pos] | (size_t)(uint8_t)data[pos + 1] << 8);
+    }
+    return std::min(pos, data.size());
+  }
+
+private:
+  static void PutString(std::string &out, const std::string &s) {
+    uint16_t len = (uint16_t)std::min<size_t>(s.size(), 0xffff);
+    out.push_back((char)(len & 0xff));
+    out.push_back((char)(len >> 8));
+    out.append(s, 0, len);
+  }
+
+  std::string EncodeHeader(const DaoMetricsRow &row) const {
+    std::string h;
+    if (m_format == DaoMetricsFormat::Csv) {
+      for (size_t i = 0; i < row.tags.size(); ++i) h += (i ? "," : "") + row.tags[i].first;
+      for (size_t i = 0; i < row.values.size(); ++i) h += (i || !row.tags.empty() ? "," : "") + row.values[i].first;
+      return h + "\n";
+    }
+    h.append(kMetricsMagic, sizeof(kMetricsMagic));
+    for (uint32_t n : {(uint32_t)row.tags.size(), (uint32_t)row.values.size()}) {
+      for (int b = 0; b < 4; ++b) h.push_back((char)(n >> (8 * b)));
+    }
+    for (const auto &t : row.tags) PutString(h, t.first);
+    for (const auto &v : row.values) PutString(h, v.first);
+    return h;
+  }
+
+  bool FlushAppend() {
+    int fd = open(m_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return Fail(std::strerror(errno));
+    flock(fd, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 || Fail(std::strerror(errno));
+    if (ok && st.st_size != 0) {
+      // CSV headers end in a newline and binary ones give their counts first, so
+      // equal leading bytes mean equal headers.
+      std::string existing(m_header.size(), '\0');
+      ok = (pread(fd, &existing[0], existing.size(), 0) == (ssize_t)existing.size() && existing == m_header) ||
+           Fail("its header has other columns; write to another file");
+    }
+    ok = ok && (WriteAll(fd, st.st_size == 0 ? m_header + m_body : m_body) || Fail(std::strerror(errno)));
+    flock(fd, LOCK_UN);
+    close(fd);
+    return ok;
+  }
+
+  bool FlushReplace() {
+    std::string tmp = m_path + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return Fail(std::strerror(errno));
+    bool ok = WriteAll(fd, m_header + m_body);
+    ok = close(fd) == 0 && ok;
+    if (ok && rename(tmp.c_str(), m_path.c_str()) == 0) return true;
+    Fail(std::strerror(errno));
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  bool Fail(const std::string &why) {
+    m_error = why;
+    return false;
+  }
+
+  std::string m_path;
+  DaoMetricsFormat m_format;
+  DaoMetricsMode m_mode;
+  std::string m_header;
+  std::string m_body;
+  std::string m_error;
+};
+
+// Concatenates encoded metrics files sharing one schema into out (temp + rename),
+// keeping only the first header. Returns the number of inputs merged.
+inline uint32_t MergeMetricsFiles(const std::vector<std::string> &inputs, const std::string &out, DaoMetricsFormat format) {
+  std::string merged;
+  uint32_t count = 0;
+  for (const std::string &path : inputs) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t header = DaoMetricsWriter::HeaderLength(data, format);
+    if (header == 0 || header >= data.size()) continue;
+    merged.append(data, count == 0 ? 0 : header, std::string::npos);
+    ++count;
+  }
+  std::string tmp = out + ".tmp." + std::to_string(getpid());
+  std::ofstream o(tmp, std::ios::binary | std::ios::trunc);
+  o << merged;
+  o.close();
+  if (!o || rename(tmp.c_str(), out.c_str()) != 0) {
+    unlink(tmp.c_str());
+    return 0;
+  }
+  return count;
+}
+
+// Wall-clock UTC time, ISO 8601, for tagging rows.
+inline std::string UtcTimestamp() {
+  std::time_t now = std::time(nullptr);
+  std::tm tm;
+  gmtime_r(&now, &tm);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  return buf;
+}
+
+// ---------------------- Duplicate payload cache --------------------------
+// Fingerprints of recently accepted datagrams (sender address + raw payload bytes),
+// so that exact replays are rejected before they are decoded. The table is 4-way
+// set associative and stores full 64-bit fingerprints, so a false hit needs a
+// 64-bit collision within one set. An entry ages out maxAgeNs after the accept it
+// records, and a full set overwrites its oldest way: the cache only ever forgets,
+// leaving the DAO to the freshness policy as before.
+class DupPayloadCache {
+public:
+  DupPayloadCache() : m_mask(0), m_maxAgeNs(0) {}
+
+  // entries is rounded up to a power of two (at least one set); 0 disables the cache.
+  void SetCapacity(uint32_t entries, int64_t maxAgeNs) {
+    m_maxAgeNs = maxAgeNs;
+    m_ways.clear();
+    m_mask = 0;
+    if (entries == 0) return;
+    uint32_t sets = 1;
+    while (sets * kWays < entries) sets *= 2;
+    m_ways.assign((size_t)sets * kWays, Way{0, 0});
+    m_mask = sets - 1;
+  }
+
+  bool Enabled() const { return !m_ways.empty(); }
+  uint32_t Capacity() const { return m_ways.size(); }
+
+  void Save(DaoSnapshotWriter &w) const {
+    w.Put(m_mask);
+    w.Put(m_maxAgeNs);
+    w.PutArray(m_ways);
+  }
+  bool Load(DaoSnapshotReader &r) {
+    if (!(r.Get(m_mask) && r.Get(m_maxAgeNs) && r.GetArray(m_ways))) return false;
+    if (!m_ways.empty() && m_ways.size() != ((size_t)m_mask + 1) * kWays) return r.Fail("inconsistent duplicate cache in snapshot");
+    return true;
+  }
+
+  // Never 0, which marks an empty way.
+  static uint64_t Fingerprint(const DaoSenderKey &key, const uint8_t *wire, uint32_t len) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+    auto mix = [&h](uint64_t w) {
+      h = (h ^ w) * 0xff51afd7ed558ccdULL;
+      h ^= h >> 32;
+    };
+    uint64_t w;
+    std::memcpy(&w, key.addr, 8);
+    mix(w);
+    std::memcpy(&w, key.addr + 8, 8);
+    mix(w);
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+      std::memcpy(&w, wire + i, 8);
+      mix(w);
+    }
+    w = 0;
+    std::memcpy(&w, wire + i, len - i);
+    mix(w);
+    h = (h ^ (h >> 29)) * 0xbf58476d1ce4e5b9ULL;
+    return (h ^ (h >> 32)) | 1;
+  }
+
+  bool Contains(uint64_t fp, int64_t nowNs) const {
+    const Way *set = &m_ways[SetOf(fp)];
+    for (uint32_t i = 0; i < kWays; ++i) {
+      if (set[i].fp == fp) return nowNs - set[i].acceptedNs <= m_maxAgeNs;
+    }
+    return false;
+  }
+
+  void Insert(uint64_t fp, int64_t nowNs) {
+    Way *set = &m_ways[SetOf(fp)];
+    Way *victim = set;
+    for (uint32_t i = 0; i < kWays; ++i) {
+      if (set[i].fp == fp || set[i].fp == 0) { victim = &set[i]; break; }
+      if (set[i].acceptedNs < victim->acceptedNs) victim = &set[i];
+    }
+    *victim = Way{fp, nowNs};
+  }
+
+private:
+  static constexpr uint32_t kWays = 4;
+  struct Way {
+    uint64_t fp;
+    int64_t acceptedNs;
+  };
+
+  // The low bit is forced on, so sets come from the high bits.
+  size_t SetOf(uint64_t fp) const { return (size_t)((fp >> 32) & m_mask) * kWays; }
+
+  std::vector<Way> m_ways;
+  uint32_t m_mask;
+  int64_t m_maxAgeNs;
+};
+
+// ---------------------- Root state sync ----------------------------------
+// Roots sharing one DODAG exchange deltas of the per-sender state they accepted,
+// so a DAO replayed to another root is judged against the newest state anywhere.
+// A delta datagram (network byte order): [0..1] magic 0xDA 0x5C, [2] version,
+// [3] entry count, then per entry the 16-byte sender key, u32 last seq and
+// u64 last origin timestamp (ns). kDaoSyncMaxEntries keeps it within one
+// 1280-byte IPv6 minimum MTU.
+struct DaoSyncEntry {
+  DaoSenderKey key;
+  uint32_t seq;
+  int64_t origNs;
+};
+
+const uint8_t kDaoSyncMagic1 = 0x5C;
+const uint32_t kDaoSyncHeader = 4;
+const uint32_t kDaoSyncEntrySize = 16 + 4 + 8;
+const uint32_t kDaoSyncMaxEntries = 40;
+const uint32_t kDaoSyncMaxSize = kDaoSyncHeader + kDaoSyncMaxEntries * kDaoSyncEntrySize;
+
+// Writes up to kDaoSyncMaxEntries of entries into buf; returns the encoded length.
+inline uint32_t SerializeDaoSync(const DaoSyncEntry *entries, uint32_t count, uint8_t *buf) {
+  count = std::min(count, kDaoSyncMaxEntries);
+  buf[0] = kDaoMagic0; buf[1] = kDaoSyncMagic1; buf[2] = kDaoVersion; buf[3] = (uint8_t)count;
+  uint8_t *b = buf + kDaoSyncHeader;
+  for (uint32_t i = 0; i < count; ++i, b += kDaoSyncEntrySize) {
+    std::memcpy(b, entries[i].key.addr, 16);
+    PutU32(b + 16, entries[i].seq);
+    PutU64(b + 20, (uint64_t)entries[i].origNs);
+  }
+  return kDaoSyncHeader + count * kDaoSyncEntrySize;
+}
+
+// Calls visit(entry) per entry; false (visiting nothing) for a malformed delta.
+template <class Visit>
+bool ForEachDaoSyncEntry(const uint8_t *buf, uint32_t len, Visit visit) {
+  if (len < kDaoSyncHeader || buf[0] != kDaoMagic0 || buf[1] != kDaoSyncMagic1 || buf[2] != kDaoVersion) return false;
+  if (len != kDaoSyncHeader + buf[3] * kDaoSyncEntrySize) return false;
+  for (const uint8_t *b = buf + kDaoSyncHeader; b < buf + len; b += kDaoSyncEntrySize) {
+    DaoSyncEntry e;
+    std::memcpy(e.key.addr, b, 16);
+    e.seq = GetU32(b + 16);
+    e.origNs = (int64_t)GetU64(b + 20);
+    visit(e);
+  }
+  return true;
+}
+
+// ---------------------- Validation core ----------------------------------
+// What the root does with a decoded DAO: sender lookup, inter-arrival bookkeeping,
+// the freshness verdict and the run counters. The ns-3 root app and the offline
+// trace driver both feed it, so their metrics are computed identically.
+// Verdict counts of one sender, for the summary's per-sender breakdown.
+struct DaoSenderVerdicts {
+  DaoSenderKey key;
+  uint64_t rejected;
+  uint32_t verdicts[kDaoVerdicts];
+};
+
+class DaoValidator {
+public:
+  static constexpr uint32_t kSummarySenders = 5; // senders in the summary's breakdown
+
+  explicit DaoValidator(std::unique_ptr<FreshnessPolicy> policy)
+    : m_policy(std::move(policy)), m_rejectsRepeats(RejectsRepeats()), m_total(0), m_verdicts(),
+      m_mergedSenders(0), m_mergedCapacity(0), m_mergedEvictions(0), m_mergedDupCapacity(0) {}
+
+  void SetPolicy(std::unique_ptr<FreshnessPolicy> policy) {
+    m_policy = std::move(policy);
+    m_rejectsRepeats = RejectsRepeats();
+  }
+  const char *PolicyName() const { return m_policy->Name(); }
+
+  DaoVerdict RepeatVerdict() const { return m_policy->RepeatVerdict(); }
+  bool RejectsRepeats() const { return RepeatVerdict() != DaoVerdict::Accept; }
+
+  // Judges p, received from key at arrivalNs; slot receives the sender's table slot.
+  DaoVerdict Validate(const DaoSenderKey &key, const DaoPayload &p, int64_t arrivalNs, uint32_t &slot) {
+    bool firstContact;
+    slot = Lookup(key, firstContact);
+    return ValidateAt(slot, firstContact, p, arrivalNs);
+  }
+
+  // Validate in two steps, for callers judging several DAOs of one sender in a row.
+  // The slot stays valid until the next Lookup of another sender.
+  uint32_t Lookup(const DaoSenderKey &key, bool &firstContact) { return m_senders.FindOrInsert(key, firstContact); }
+
+  DaoVerdict ValidateAt(uint32_t slot, bool firstContact, const DaoPayload &p, int64_t arrivalNs) {
+    SenderState &st = m_senders.At(slot);
+    Arrive(st, firstContact, arrivalNs);
+    return Count(st, m_policy->Check(slot, st, p, arrivalNs));
+  }
+
+  // Counts a rejection decided without the policy: a repeat of the sender's newest
+  // accepted DAO under a policy that RejectsRepeats. Statistics and the verdict
+  // match ValidateAt.
+  DaoVerdict RejectRepeatAt(uint32_t slot, int64_t arrivalNs) {
+    SenderState &st = m_senders.At(slot);
+    Arrive(st, false, arrivalNs);
+    return Count(st, RepeatVerdict());
+  }
+
+  // Exact-replay pre-check on the raw datagram, see DupPayloadCache. Returns true
+  // and counts a Duplicate rejection if this sender's identical bytes were accepted
+  // within the cache age; otherwise fp receives the fingerprint to pass to
+  // RememberAccepted once the decoded DAO is accepted. A no-op returning false
+  // while the cache is off.
+  bool RejectDuplicate(const DaoSenderKey &key, const uint8_t *wire, uint32_t len, int64_t arrivalNs,
+                       uint32_t &slot, uint64_t &fp) {
+    // The cache only short-cuts verdicts the policy would reach: one that accepts
+    // repeats (seq, burst alone) never sees it.
+    if (!m_dups.Enabled() || !m_rejectsRepeats) return false;
+    fp = DupPayloadCache::Fingerprint(key, wire, len);
+    if (!m_dups.Contains(fp, arrivalNs)) return false;
+    bool firstContact;
+    slot = Lookup(key, firstContact);
+    SenderState &st = m_senders.At(slot);
+    Arrive(st, firstContact, arrivalNs);
+    Count(st, DaoVerdict::Duplicate);
+    return true;
+  }
+
+  void RememberAccepted(uint64_t fp, int64_t arrivalNs) {
+    if (m_dups.Enabled() && m_rejectsRepeats) m_dups.Insert(fp, arrivalNs);
+  }
+
+  // Folds in a sender's newest state as accepted by another root (see DaoSyncEntry);
+  // no DAO or verdict is counted. Returns true if the local state advanced.
+  bool Learn(const DaoSyncEntry &e) {
+    if (e.origNs < 0) return false; // no DAO decodes to it (DaoTimestampFits)
+    bool firstContact;
+    uint32_t slot = Lookup(e.key, firstContact);
+    SenderState &st = m_senders.At(slot);
+    if (firstContact) st.prevArrivalNs = kNotHeard;
+    DaoPayload p{e.seq, (uint64_t)e.origNs / 1000000000, (uint64_t)e.origNs % 1000000000};
+    return m_policy->Learn(slot, st, p);
+  }
+
+  DupPayloadCache &DupCache() { return m_dups; }
+
+  uint64_t Total() const { return m_total; }
+  uint64_t Accepted() const { return m_verdicts[(uint32_t)DaoVerdict::Accept]; }
+  uint64_t Rejected() const { return m_total - Accepted(); }
+  uint64_t Verdicts(DaoVerdict v) const { return m_verdicts[(uint32_t)v]; }
+  double RejectPct() const { return m_total ? (double)Rejected() * 100.0 / (double)m_total : 0.0; }
+  SenderTable &Senders() { return m_senders; }
+  const SenderTable &Senders() const { return m_senders; }
+
+  // Sender-table occupancy, including validators merged into this one.
+  uint64_t SenderCount() const { return m_senders.Size() + m_mergedSenders; }
+  uint64_t SenderCapacity() const { return m_senders.Capacity() + m_mergedCapacity; }
+  uint64_t Evictions() const { return m_senders.Evictions() + m_mergedEvictions; }
+  uint64_t DupCacheCapacity() const { return m_dups.Capacity() + m_mergedDupCapacity; }
+
+  // The n senders with the most rejections, most first, including merged
+  // validators' own top n. Counts of evicted senders are lost with their state.
+  std::vector<DaoSenderVerdicts> TopRejecting(uint32_t n) const {
+    std::vector<DaoSenderVerdicts> top = m_mergedTop;
+    for (uint32_t slot = 0; slot < m_senders.Size(); ++slot) {
+      const SenderState &st = m_senders.At(slot);
+      DaoSenderVerdicts sv{m_senders.KeyAt(slot), 0, {}};
+      for (uint32_t v = 0; v < kDaoVerdicts; ++v) {
+        sv.verdicts[v] = st.verdicts[v];
+        if (v != (uint32_t)DaoVerdict::Accept) sv.rejected += st.verdicts[v];
+      }
+      if (sv.rejected) top.push_back(sv);
+    }
+    auto most = [](const DaoSenderVerdicts &a, const DaoSenderVerdicts &b) { return a.rejected > b.rejected; };
+    n = std::min<size_t>(n, top.size());
+    std::partial_sort(top.begin(), top.begin() + n, top.end(), most);
+    top.resize(n);
+    return top;
+  }
+
+  // Adds another validator's counters and inter-arrival statistics; sender state
+  // is not merged. Exact when the two saw disjoint sets of senders.
+  void Merge(const DaoValidator &o) {
+    m_total += o.m_total;
+    for (uint32_t v = 0; v < kDaoVerdicts; ++v) m_verdicts[v] += o.m_verdicts[v];
+    m_interArrival.Merge(o.m_interArrival);
+    m_interArrivalHist.Merge(o.m_interArrivalHist);
+    m_mergedSenders += o.SenderCount();
+    m_mergedCapacity += o.SenderCapacity();
+    m_mergedEvictions += o.Evictions();
+    m_mergedDupCapacity += o.DupCacheCapacity();
+    for (const DaoSenderVerdicts &sv : o.TopRejecting(kSummarySenders)) m_mergedTop.push_back(sv);
+  }
+
+  // Policy name, counters, statistics, sender table, policy and duplicate-cache
+  // state. Figures of merged validators are not included.
+  void Save(DaoSnapshotWriter &w) const {
+    w.PutString(PolicyName());
+    w.Put((uint32_t)sizeof(SenderState));
+    w.Put(m_total);
+    w.Put(m_verdicts);
+    w.Put(m_interArrival);
+    m_interArrivalHist.Save(w);
+    m_senders.Save(w);
+    m_policy->Save(w);
+    m_dups.Save(w);
+  }
+
+  // Replaces this validator's state with a snapshot's. The snapshot must have been
+  // taken under the same freshness policy as the one installed.
+  bool Load(DaoSnapshotReader &r) {
+    std::string policy;
+    uint32_t stateSize = 0;
+    if (!r.GetString(policy) || !r.Get(stateSize)) return false;
+    if (policy != PolicyName()) return r.Fail("snapshot has freshness policy " + policy + ", not " + PolicyName());
+    if (stateSize != sizeof(SenderState)) return r.Fail("snapshot is from another build");
+    return r.Get(m_total) && r.Get(m_verdicts) && r.Get(m_interArrival) && m_interArrivalHist.Load(r) &&
+           m_senders.Load(r) && m_policy->Load(r) && m_dups.Load(r);
+  }
+
+  // The measurement columns of a metrics row. Inter-arrival figures are zero
+  // until some sender has been heard twice.
+  void AppendMetrics(std::vector<std::pair<std::string, double>> &values) const {
+    values.insert(values.end(), {{"total", (double)m_total},
+                                 {"accepted", (double)Accepted()},
+                                 {"rejected", (double)Rejected()},
+                                 {"reject_pct", RejectPct()},
+                                 {"avg_delay_s", m_interArrival.mean},
+                                 {"stddev_s", m_interArrival.StdDev()},
+                                 {"min_s", m_interArrival.min},
+                                 {"max_s", m_interArrival.max},
+                                 {"p50_s", DelayQuantile(0.50)},
+                                 {"p99_s", DelayQuantile(0.99)}});
+    // One rej_<reason> column per rejection reason, always present
+    for (uint32_t v = 1; v < kDaoVerdicts; ++v) {
+      values.emplace_back(std::string("rej_") + VerdictName((DaoVerdict)v), (double)m_verdicts[v]);
+    }
+    if (SenderCapacity()) {
+      values.insert(values.end(), {{"sender_capacity", (double)SenderCapacity()},
+                                   {"senders", (double)SenderCount()},
+                                   {"evictions", (double)Evictions()}});
+    }
+  }
+
+  // Policy, counters and inter-arrival lines of the end-of-run console summary,
+  // then the rejections by reason, overall and for the most rejected senders.
+  void PrintSummary(std::ostream &os) const {
+    os << "Freshness policy:    " << PolicyName() << std::endl;
+    os << "Total DAOs received: " << m_total << std::endl;
+    os << "Accepted DAOs:       " << Accepted() << std::endl;
+    os << "Rejected DAOs:       " << Rejected() << std::endl;
+    os << "Replay rejection %:  " << std::fixed << std::setprecision(2) << RejectPct() << std::endl;
+    os << "Average inter-arrival delay (s): " << m_interArrival.mean << std::endl;
+    os << std::setprecision(4);
+    os << "Inter-arrival stddev (s):        " << m_interArrival.StdDev() << std::endl;
+    os << "Inter-arrival min / max (s):     " << m_interArrival.min << " / " << m_interArrival.max << std::endl;
+    os << "Inter-arrival p50 / p99 (s):     " << DelayQuantile(0.50) << " / " << DelayQuantile(0.99) << std::endl;
+    if (SenderCapacity()) {
+      os << "Sender table:        " << SenderCount() << " / " << SenderCapacity() << " senders, "
+         << Evictions() << " evictions" << std::endl;
+    }
+    if (!Rejected()) return;
+    os << "Rejected by reason:  " << ReasonList(m_verdicts) << std::endl;
+    os << "Most rejected senders:" << std::endl;
+    for (const DaoSenderVerdicts &sv : TopRejecting(kSummarySenders)) {
+      os << "  " << FormatSenderKey(sv.key) << ": " << sv.rejected << " of "
+         << sv.rejected + sv.verdicts[(uint32_t)DaoVerdict::Accept] << " (" << ReasonList(sv.verdicts) << ")" << std::endl;
+    }
+  }
+
+private:
+  // prevArrivalNs of a sender only learned of so far, so its first DAO starts
+  // the inter-arrival statistics like a first contact.
+  static constexpr int64_t kNotHeard = INT64_MIN;
+
+  void Arrive(SenderState &st, bool firstContact, int64_t arrivalNs) {
+    ++m_total;
+    if (!firstContact && st.prevArrivalNs != kNotHeard) {
+      int64_t deltaNs = arrivalNs - st.prevArrivalNs;
+      st.interArrival.Add(deltaNs / 1e9);
+      m_interArrival.Add(deltaNs / 1e9);
+      m_interArrivalHist.Add((uint64_t)deltaNs);
+    }
+    st.prevArrivalNs = arrivalNs;
+  }
+
+  DaoVerdict Count(SenderState &st, DaoVerdict v) {
+    ++m_verdicts[(uint32_t)v];
+    ++st.verdicts[(uint32_t)v];
+    return v;
+  }
+
+  // "reason=count" for every rejection reason that occurred.
+  template <class T>
+  static std::string ReasonList(const T (&counts)[kDaoVerdicts]) {
+    std::string out;
+    for (uint32_t v = 1; v < kDaoVerdicts; ++v) {
+      if (counts[v]) out += (out.empty() ? "" : ", ") + std::string(VerdictName((DaoVerdict)v)) + "=" + std::to_string(counts[v]);
+    }
+    return out;
+  }
+
+  // Histogram quantiles are bucket midpoints; keep them inside the observed range.
+  double DelayQuantile(double q) const {
+    double d = m_interArrivalHist.Quantile(q) / 1e9;
+    return std::min(std::max(d, m_interArrival.min), m_interArrival.max);
+  }
+
+  std::unique_ptr<FreshnessPolicy> m_policy;
+  bool m_rejectsRepeats;              // cached RejectsRepeats(), gates the duplicate cache
+  uint64_t m_total;
+  uint64_t m_verdicts[kDaoVerdicts]; // DAOs per verdict
+  RunningStats m_interArrival;      // all senders, seconds
+  LogHistogram m_interArrivalHist;  // all senders, nanoseconds (quantiles)
+  SenderTable m_senders;            // anti-replay state and per-sender metrics
+  uint64_t m_mergedSenders;         // table figures of merged validators
+  uint64_t m_mergedCapacity;
+  uint64_t m_mergedEvictions;
+  uint64_t m_mergedDupCapacity;
+  std::vector<DaoSenderVerdicts> m_mergedTop; // merged validators' most rejected senders
+  DupPayloadCache m_dups;           // exact-replay pre-check (off by default)
+};
+
+// ---------------------- DAO trace files ----------------------------------
+// Datagrams as received by the root, for offline replay (dao-trace-replay.cc).
+// The magic "DAOTRCv1", then per datagram: arrival time (i64 ns), source address
+// (16 bytes), payload length (u16) and the payload bytes; integers little-endian.
+const char kTraceMagic[8] = {'D', 'A', 'O', 'T', 'R', 'C', 'v', '1'};
+const uint32_t kTraceRecordHeader = 8 + 16 + 2;
+
+class DaoTraceWriter {
+public:
+  DaoTraceWriter() : m_fd(-1) {}
+  ~DaoTraceWriter() { Close(); }
+
+  // Truncates path and writes the file magic.
+  bool Open(const std::string &path) {
+    Close();
+    m_path = path;
+    m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) return false;
+    m_buf.assign(kTraceMagic, sizeof(kTraceMagic));
+    return true;
+  }
+
+  bool IsOpen() const { return m_fd >= 0; }
+  const std::string &GetPath() const { return m_path; }
+
+  // Buffers one datagram; the buffer is written out in large chunks.
+  void Add(int64_t arrivalNs, const DaoSenderKey &from, const uint8_t *payload, uint16_t len) {
+    for (int b = 0; b < 8; ++b) m_buf.push_back((char)((uint64_t)arrivalNs >> (8 * b)));
+    m_buf.append((const char *)from.addr, sizeof(from.addr));
+    m_buf.push_back((char)(len & 0xff));
+    m_buf.push_back((char)(len >> 8));
+    m_buf.append((const char *)payload, len);
+    if (m_buf.size() >= kChunk) Flush();
+  }
+
+  bool Flush() {
+    if (m_fd < 0 || m_buf.empty()) return m_fd >= 0;
+    bool ok = WriteAll(m_fd, m_buf);
+    m_buf.clear();
+    return ok;
+  }
+
+  void Close() {
+    if (m_fd < 0) return;
+    Flush();
+    close(m_fd);
+    m_fd = -1;
+  }
+
+private:
+  static constexpr size_t kChunk = 1 << 20;
+
+  std::string m_path;
+  int m_fd;
+  std::string m_buf;
+};
+
+// Calls visit(arrivalNs, key, payload, len) for each datagram of an in-memory trace
+// file. Returns false if the magic is missing or the file ends mid-record.
+template <class Visit>
+bool ForEachTraceRecord(const uint8_t *data, size_t size, Visit &&visit) {
+  if (size < sizeof(kTraceMagic) || std::memcmp(data, kTraceMagic, sizeof(kTraceMagic)) != 0) return false;
+  size_t pos = sizeof(kTraceMagic);
+  while (pos + kTraceRecordHeader <= size) {
+    uint64_t arrival = 0;
+    for (int b = 7; b >= 0; --b) arrival = arrival << 8 | data[pos + b];
+    DaoSenderKey key;
+    std::memcpy(key.addr, data + pos + 8, sizeof(key.addr));
+    uint32_t len = data[pos + 24] | (uint32_t)data[pos + 25] << 8;
+    pos += kTraceRecordHeader;
+    if (pos + len > size) return false;
+    visit((int64_t)arrival, key, data + pos, len);
+    pos += len;
+  }
+  return pos == size;
+}
+
+// ---------------------- Sharded validation -------------------------------
+// Bounded single-producer/single-consumer ring. Each side keeps a cached copy of
+// the other's index so that the shared cache line is touched only when the ring
+// looks full (producer) or empty (consumer).
+template <class T>
+class SpscQueue {
+public:
+  // capacity is rounded up to a power of two.
+  explicit SpscQueue(uint32_t capacity) : m_head(0), m_tail(0), m_headCache(0), m_tailCache(0) {
+    uint32_t cap = 2;
+    while (cap < capacity) cap <<= 1;
+    m_slots.resize(cap);
+    m_mask = cap - 1;
+  }
+
+  bool TryPush(const T &v) {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_headCache > m_mask) {
+      m_headCache = m_head.load(std::memory_order_acquire);
+      if (tail - m_headCache > m_mask) return false;
+    }
+    m_slots[tail & m_mask] = v;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T &v) {
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tailCache) {
+      m_tailCache = m_tail.load(std::memory_order_acquire);
+      if (head == m_tailCache) return false;
+    }
+    v = m_slots[head & m_mask];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> m_slots;
+  uint64_t m_mask;
+  alignas(64) std::atomic<uint64_t> m_head;   // next slot to pop (consumer)
+  alignas(64) std::atomic<uint64_t> m_tail;   // next slot to push (producer)
+  alignas(64) uint64_t m_headCache;           // producer's view of m_head
+  alignas(64) uint64_t m_tailCache;           // consumer's view of m_tail
+};
+
+// Validation spread over worker threads by sender. A single reader thread Submits
+// datagrams; each goes to the shard owning its source address through that shard's
+// SPSC queue, so per-sender arrival order and state are exactly those of one
+// DaoValidator. Payloads are decoded on the workers and must stay valid until
+// Finish (e.g. a memory-mapped trace).
+class DaoShardedValidator {
+public:
+  using PolicyFactory = std::function<std::unique_ptr<FreshnessPolicy>()>;
+
+  // setup, if given, configures each shard's validator (e.g. its sender capacity)
+  // before the workers start.
+  DaoShardedValidator(uint32_t shards, const PolicyFactory &makePolicy,
+                      const std::function<void(DaoValidator &)> &setup = nullptr, uint32_t queueDepth = 1 << 14) {
+    for (uint32_t i = 0; i < std::max<uint32_t>(shards, 1); ++i) {
+      m_shards.push_back(std::make_unique<Shard>(makePolicy(), queueDepth));
+      if (setup) setup(m_shards.back()->validator);
+    }
+    for (auto &shard : m_shards) {
+      Shard *s = shard.get();
+      s->worker = std::thread([s] { s->Run(); });
+    }
+  }
+
+  ~DaoShardedValidator() { Stop(); }
+
+  uint32_t Shards() const { return m_shards.size(); }
+
+  // Reader thread only. Spins (yielding) while the target shard's queue is full.
+  void Submit(int64_t arrivalNs, const DaoSenderKey &key, const uint8_t *payload, uint32_t len) {
+    Item item{key, arrivalNs, payload, len};
+    Shard &s = *m_shards[ShardOf(key)];
+    while (!s.queue.TryPush(item)) std::this_thread::yield();
+  }
+
+  // Drains the queues, joins the workers and folds every shard into merged.
+  // Returns the number of undecodable payloads.
+  uint64_t Finish(DaoValidator &merged) {
+    Stop();
+    uint64_t malformed = 0;
+    for (auto &s : m_shards) {
+      merged.Merge(s->validator);
+      malformed += s->malformed;
+    }
+    return malformed;
+  }
+
+private:
+  struct Item {
+    DaoSenderKey key;
+    int64_t arrivalNs;
+    const uint8_t *payload;
+    uint32_t len;
+  };
+
+  struct Shard {
+    Shard(std::unique_ptr<FreshnessPolicy> policy, uint32_t depth)
+      : validator(std::move(policy)), queue(depth), done(false), malformed(0) {}
+
+    void Run() {
+      Item item;
+      for (;;) {
+        if (!queue.TryPop(item)) {
+          if (!done.load(std::memory_order_acquire)) { std::this_thread::yield(); continue; }
+          // done is set after the last push, so this pop sees everything left.
+          if (!queue.TryPop(item)) return;
+        }
+        if (item.len > kDaoMaxWireSize) { ++malformed; continue; }
+        uint32_t slot;
+        uint64_t fp = 0;
+        if (validator.RejectDuplicate(item.key, item.payload, item.len, item.arrivalNs, slot, fp)) continue;
+        DaoPayload p;
+        if (!DeserializeDao(item.payload, item.len, p)) { ++malformed; continue; }
+        if (validator.Validate(item.key, p, item.arrivalNs, slot) == DaoVerdict::Accept) {
+          validator.RememberAccepted(fp, item.arrivalNs);
+        }
+      }
+    }
+
+    DaoValidator validator;
+    SpscQueue<Item> queue;
+    std::atomic<bool> done;
+    uint64_t malformed;
+    std::thread worker;
+  };
+
+  // Independent of SenderTable's hash, and taken from the high bits, so each
+  // shard's table still sees well-spread keys.
+  uint32_t ShardOf(const DaoSenderKey &key) const {
+    uint64_t lo, hi;
+    std::memcpy(&lo, key.addr, 8);
+    std::memcpy(&hi, key.addr + 8, 8);
+    uint64_t h = (hi ^ (lo * 0xc2b2ae3d27d4eb4fULL)) * 0x165667b19e3779f9ULL;
+    return (uint32_t)(((h >> 32) * m_shards.size()) >> 32);
+  }
+
+  void Stop() {
+    for (auto &s : m_shards) s->done.store(true, std::memory_order_release);
+    for (auto &s : m_shards) {
+      if (s->worker.joinable()) s->worker.join();
+    }
+  }
+
+  std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+#endif // DAO_REPLAY_CORE_H
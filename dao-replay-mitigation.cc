@@ -16,40 +16,68 @@
 #include "ns3/ipv6-address-helper.h"
 #include "ns3/ipv6-static-routing-helper.h"
 #include "ns3/point-to-point-module.h"
-#include "ns3/global-route-manager.h"
-
-#include <map>
+#include "ns3/csma-module.h"
+#include "ns3/traffic-control-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <memory>
+#include <tuple>
 #include <sstream>
 #include <vector>
 #include <fstream>
 #include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("DaoReplayMitigation");
 
-// ---------------------- Payload helpers ----------------------------------
-struct DaoPayload { uint32_t seq; uint64_t tsSeconds; uint64_t tsNano; };
-
-std::string SerializeDao(const DaoPayload &p) {
-  std::ostringstream oss;
-  oss << "DAO:" << p.seq << ":" << p.tsSeconds << ":" << p.tsNano;
-  return oss.str();
+// ---------------------- Hot-path logging ---------------------------------
+// Per-packet log statements go through DAO_PKT_LOG. Building with
+// -DDAO_HOT_PATH_LOG=0 compiles them out, leaving only the aggregated
+// summaries (DaoLogMode::Summary) and per-run messages; as with NS_LOG in an
+// optimized ns-3 build, the arguments are still type-checked but never evaluated.
+#ifndef DAO_HOT_PATH_LOG
+#define DAO_HOT_PATH_LOG 1
+#endif
+
+#if DAO_HOT_PATH_LOG
+#define DAO_PKT_LOG(level, msg) NS_LOG_##level(msg)
+#else
+#define DAO_PKT_LOG(level, msg) do { if (false) { std::clog << msg; } } while (false)
+#endif
+
+// What the root and the attackers log while traffic flows:
+//   packet:  one line per DAO / replay batch (legacy; needs DAO_HOT_PATH_LOG)
+//   summary: per-sender counts once per log period
+//   off:     nothing beyond per-run messages
+enum class DaoLogMode { Packet, Summary, Off };
+
+bool ParseLogMode(const std::string &name, DaoLogMode &out) {
+  if (name == "packet") { out = DaoLogMode::Packet; return true; }
+  if (name == "summary") { out = DaoLogMode::Summary; return true; }
+  if (name == "off") { out = DaoLogMode::Off; return true; }
+  return false;
 }
 
-bool DeserializeDao(const std::string &s, DaoPayload &out) {
-  std::istringstream iss(s);
-  std::string tag, seqs, secs, nanos;
-  if (!std::getline(iss, tag, ':') || tag != "DAO") return false;
-  if (!std::getline(iss, seqs, ':') || !std::getline(iss, secs, ':') || !std::getline(iss, nanos, ':'))
-    return false;
-  try {
-    out.seq = std::stoul(seqs);
-    out.tsSeconds = std::stoull(secs);
-    out.tsNano = std::stoull(nanos);
-  } catch (...) { return false; }
-  return true;
-}
+// Codecs, statistics, sender table and freshness policies (after DAO_PKT_LOG).
+#include "dao-replay-core.h"
 
 // Forward-declare attacker for optional deterministic snoop (not used here)
 class DaoAttackerApp;
@@ -58,13 +86,32 @@ static DaoAttackerApp* g_attackerApp = nullptr; // used in other variants; unuse
 // ---------------------- DaoSenderApp (sensor) --------------------------------
 class DaoSenderApp : public Application {
 public:
-  DaoSenderApp() : m_socket(0), m_peer(), m_mirror(), m_seq(1), m_interval(Seconds(10)) {}
+  DaoSenderApp()
+    : m_socket(0), m_peer(), m_mirror(), m_seq(1), m_interval(Seconds(10)), m_format(DaoWireFormat::Binary),
+      m_jitter(CreateObject<UniformRandomVariable>()), m_pool(std::make_shared<DaoPayloadPool>()) {}
   virtual ~DaoSenderApp() { m_socket = 0; }
 
   void Setup(Address rootAddr, Address mirrorAddr, uint32_t startSeq, Time interval) {
     m_peer = rootAddr; m_mirror = mirrorAddr; m_seq = startSeq; m_interval = interval;
   }
 
+  void SetWireFormat(DaoWireFormat format) { m_format = format; }
+
+  // Encode buffers come from pool, normally the one shared by the node's apps.
+  void SetPayloadPool(std::shared_ptr<DaoPayloadPool> pool) { m_pool = std::move(pool); }
+
+  // Resumed runs: skips the DAOs due before at, keeping the sequence numbers and
+  // send times of the uninterrupted run. main passes the snapshot time less the
+  // path delay bound, so DAOs in flight at the snapshot are sent again.
+  void SetResumeAt(Time at) { m_resumeAt = at; }
+
+  // Fixes the start-jitter stream so runs are reproducible under RngSeedManager.
+  // Returns the number of streams used.
+  int64_t AssignStreams(int64_t stream) {
+    m_jitter->SetStream(stream);
+    return 1;
+  }
+
 private:
   virtual void StartApplication() override {
     if (!m_socket) {
@@ -72,7 +119,14 @@ private:
       m_socket->Bind(Inet6SocketAddress(Ipv6Address::GetAny(), 0));
     }
     // randomized initial offset
-    m_sendEvent = Simulator::Schedule(Seconds(1.0 + (double)rand() / RAND_MAX), &DaoSenderApp::SendDao, this);
+    Time first = Seconds(1.0 + m_jitter->GetValue(0.0, 1.0));
+    Time late = m_resumeAt - Simulator::Now() - first;
+    if (late.IsStrictlyPositive()) {
+      int64_t skipped = (late.GetNanoSeconds() + m_interval.GetNanoSeconds() - 1) / m_interval.GetNanoSeconds();
+      m_seq += skipped;
+      first += m_interval * skipped;
+    }
+    m_sendEvent = Simulator::Schedule(first, &DaoSenderApp::SendDao, this);
   }
 
   virtual void StopApplication() override {
@@ -86,22 +140,27 @@ private:
     Time now = Simulator::Now();
     DaoPayload p;
     p.seq = m_seq++;
-    p.tsSeconds = (uint64_t) now.GetSeconds();
-    p.tsNano = (uint64_t) now.GetNanoSeconds();
-
-    std::string payload = SerializeDao(p);
-    Ptr<Packet> packet = Create<Packet>((const uint8_t*)payload.c_str(), payload.size());
-
-    // Send to primary (root)
+    // Seconds and the nanoseconds within that second, so the origin timestamp the
+    // root rebuilds (tsSeconds * 1e9 + tsNano) is the send time.
+    p.tsSeconds = (uint64_t)(now.GetNanoSeconds() / 1000000000);
+    p.tsNano = (uint64_t)(now.GetNanoSeconds() % 1000000000);
+
+    // Either encoding goes straight into a pooled buffer, returned when this send is done.
+    DaoPayloadPool::Block buf = m_pool->Acquire();
+    uint32_t size = m_format == DaoWireFormat::Binary ? SerializeDaoBinary(p, buf.Data())
+                                                      : SerializeDaoText(p, (char *)buf.Data());
+    Ptr<Packet> packet = Create<Packet>(buf.Data(), size);
+
+    // Identical copy for the secondary (attacker) if set (UDP mirror). Copy() shares
+    // the payload buffer copy-on-write; it is taken before the root send adds headers
+    // to packet. Unused with --captureMode=sniff.
+    Ptr<Packet> mirrorPkt = m_mirror != Address() ? packet->Copy() : Ptr<Packet>();
+
+    // Send to primary (root), then the mirror copy
     m_socket->SendTo(packet, 0, m_peer);
+    if (mirrorPkt) m_socket->SendTo(mirrorPkt, 0, m_mirror);
 
-    // Also send an identical copy to secondary (attacker) if set (UDP mirror)
-    if (m_mirror != Address()) {
-      Ptr<Packet> copyPkt = Create<Packet>((const uint8_t*)payload.c_str(), payload.size());
-      m_socket->SendTo(copyPkt, 0, m_mirror);
-    }
-
-    NS_LOG_INFO("Sensor " << GetNode()->GetId() << " sent DAO seq=" << p.seq << " at t=" << now.GetSeconds());
+    DAO_PKT_LOG(INFO, "Sensor " << GetNode()->GetId() << " sent DAO seq=" << p.seq << " at t=" << now.GetSeconds());
 
     m_sendEvent = Simulator::Schedule(m_interval, &DaoSenderApp::SendDao, this);
   }
@@ -112,32 +171,291 @@ private:
   Address m_mirror;
   uint32_t m_seq;
   Time m_interval;
+  DaoWireFormat m_format;
+  Ptr<UniformRandomVariable> m_jitter; // initial send offset
+  Time m_resumeAt;
+  std::shared_ptr<DaoPayloadPool> m_pool;
+};
+
+// ---------------------- DaoAggregateSenderApp (many sensors per node) ---------
+// Stands in for the DaoSenderApps of many logical sensors on one node: one socket,
+// one reusable encode buffer and a hashed timer wheel of kWheelSlots ticks, so a
+// node costs one simulator event per tick holding due DAOs rather than one per
+// sensor and DAO. Send times are rounded up to the tick. Every DAO is binary,
+// encoded into one pooled buffer per tick, and
+// carries its sensor's origin id, which the root folds into the sender key
+// (ApplyDaoOrigin).
+class DaoAggregateSenderApp : public Application {
+public:
+  DaoAggregateSenderApp()
+    : m_socket(0), m_peer(), m_tickNs(1000000), m_tick(0), m_pending(0),
+      m_jitter(CreateObject<UniformRandomVariable>()), m_heads(kWheelSlots, kNone),
+      m_pool(std::make_shared<DaoPayloadPool>()) {}
+  virtual ~DaoAggregateSenderApp() { m_socket = 0; }
+
+  void Setup(Address rootAddr, Time tick) {
+    m_peer = rootAddr;
+    m_tickNs = std::max<int64_t>(tick.GetNanoSeconds(), 1);
+  }
+
+  // Schedules a logical sensor as DaoSenderApp would with the same arguments and
+  // start time; mirror, if set, receives a copy of each of its DAOs.
+  void AddSensor(uint32_t origin, uint32_t startSeq, Time start, Time interval, Address mirror) {
+    Sensor s;
+    s.origin = origin;
+    s.seq = startSeq;
+    s.dueTick = start.GetNanoSeconds(); // converted to a tick in StartApplication
+    s.intervalTicks = std::max<int64_t>((interval.GetNanoSeconds() + m_tickNs - 1) / m_tickNs, 1);
+    s.mirror = kNone;
+    if (mirror != Address()) {
+      auto it = std::find(m_mirrors.begin(), m_mirrors.end(), mirror);
+      s.mirror = it - m_mirrors.begin();
+      if (it == m_mirrors.end()) m_mirrors.push_back(mirror);
+    }
+    s.next = kNone;
+    m_sensors.push_back(s);
+  }
+
+  // As DaoSenderApp::SetPayloadPool.
+  void SetPayloadPool(std::shared_ptr<DaoPayloadPool> pool) { m_pool = std::move(pool); }
+
+  // As DaoSenderApp::SetResumeAt, for every sensor.
+  void SetResumeAt(Time at) { m_resumeNs = at.GetNanoSeconds(); }
+
+  // One stream draws every sensor's start jitter, in AddSensor order.
+  int64_t AssignStreams(int64_t stream) {
+    m_jitter->SetStream(stream);
+    return 1;
+  }
+
+private:
+  static constexpr uint32_t kWheelSlots = 4096;
+  static constexpr uint32_t kNone = 0xffffffffu;
+  struct Sensor {
+    uint32_t origin;
+    uint32_t seq;
+    int64_t dueTick;       // absolute tick of the next DAO
+    int64_t intervalTicks;
+    uint32_t mirror;       // index into m_mirrors, or kNone
+    uint32_t next;         // next sensor in the same wheel slot
+  };
+
+  virtual void StartApplication() override {
+    if (!m_socket) {
+      m_socket = Socket::CreateSocket(GetNode(), TypeId::LookupByName("ns3::UdpSocketFactory"));
+      m_socket->Bind(Inet6SocketAddress(Ipv6Address::GetAny(), 0));
+    }
+    // Same randomized initial offset as DaoSenderApp, relative to each sensor's start.
+    int64_t nowNs = Simulator::Now().GetNanoSeconds();
+    for (uint32_t i = 0; i < m_sensors.size(); ++i) {
+      Sensor &s = m_sensors[i];
+      int64_t firstNs = std::max(s.dueTick, nowNs) + Seconds(1.0 + m_jitter->GetValue(0.0, 1.0)).GetNanoSeconds();
+      s.dueTick = (firstNs + m_tickNs - 1) / m_tickNs;
+      int64_t late = (m_resumeNs + m_tickNs - 1) / m_tickNs - s.dueTick;
+      if (late > 0) {
+        int64_t skipped = (late + s.intervalTicks - 1) / s.intervalTicks;
+        s.seq += skipped;
+        s.dueTick += skipped * s.intervalTicks;
+      }
+      Insert(i);
+    }
+    m_tick = nowNs / m_tickNs;
+    ScheduleNext();
+  }
+
+  virtual void StopApplication() override {
+    if (m_tickEvent.IsPending()) Simulator::Cancel(m_tickEvent);
+    if (m_socket) m_socket->Close();
+  }
+
+  void Insert(uint32_t i) {
+    uint32_t &head = m_heads[m_sensors[i].dueTick % kWheelSlots];
+    m_sensors[i].next = head;
+    head = i;
+    ++m_pending;
+  }
+
+  // Fires the DAOs due at the current tick; sensors due in a later round of the
+  // wheel go back into the same slot.
+  void Tick() {
+    uint32_t i = m_heads[m_tick % kWheelSlots];
+    m_heads[m_tick % kWheelSlots] = kNone;
+    Time now = Simulator::Now();
+    DaoPayload p;
+    p.tsSeconds = (uint64_t)(now.GetNanoSeconds() / 1000000000); // as DaoSenderApp
+    p.tsNano = (uint64_t)(now.GetNanoSeconds() % 1000000000);
+    DaoPayloadPool::Block buf = i != kNone ? m_pool->Acquire() : DaoPayloadPool::Block();
+    while (i != kNone) {
+      Sensor &s = m_sensors[i];
+      uint32_t next = s.next;
+      --m_pending;
+      if (s.dueTick == m_tick) {
+        p.seq = s.seq++;
+        uint32_t size = SerializeDaoBinary(p, s.origin, buf.Data());
+        Ptr<Packet> packet = Create<Packet>(buf.Data(), size);
+        Ptr<Packet> mirrorPkt = s.mirror != kNone ? packet->Copy() : Ptr<Packet>(); // before headers are added
+        m_socket->SendTo(packet, 0, m_peer);
+        if (mirrorPkt) m_socket->SendTo(mirrorPkt, 0, m_mirrors[s.mirror]);
+        DAO_PKT_LOG(INFO, "Sensor " << GetNode()->GetId() << "/" << s.origin << " sent DAO seq=" << p.seq
+                                    << " at t=" << now.GetSeconds());
+        s.dueTick += s.intervalTicks;
+      }
+      Insert(i);
+      i = next;
+    }
+    ScheduleNext();
+  }
+
+  // Next tick whose slot holds a sensor, at most one wheel round ahead.
+  void ScheduleNext() {
+    if (!m_pending) return;
+    int64_t t = m_tick + 1;
+    while (m_heads[t % kWheelSlots] == kNone) ++t;
+    m_tickEvent = Simulator::Schedule(NanoSeconds(t * m_tickNs) - Simulator::Now(), &DaoAggregateSenderApp::Fire, this, t);
+  }
+
+  void Fire(int64_t tick) {
+    m_tick = tick;
+    Tick();
+  }
+
+  Ptr<Socket> m_socket;
+  Address m_peer;
+  int64_t m_tickNs;
+  int64_t m_tick;                     // tick being (or last) processed
+  uint32_t m_pending;                 // sensors on the wheel
+  EventId m_tickEvent;
+  Ptr<UniformRandomVariable> m_jitter;
+  std::vector<Sensor> m_sensors;
+  std::vector<uint32_t> m_heads;      // per wheel slot, first sensor or kNone
+  std::vector<Address> m_mirrors;     // distinct mirror targets
+  std::shared_ptr<DaoPayloadPool> m_pool;
+  int64_t m_resumeNs = 0;
 };
 
 // ---------------------- DaoAttackerApp (Compromised Sensor 0) -----------------------------------
+// Replay traffic models. Each scheduled event emits a batch of replays, so aggressive
+// attackers cost count / batch simulator events instead of one per packet.
+//   constant: one replay every gap (legacy storm)
+//   burst:    batch replays every gap
+//   poisson:  batch replays per event, exponential inter-event gaps with mean gap
+//   onoff:    burst behaviour during onTime, then silence for offTime, repeating
+enum class DaoAttackModel { Constant, Burst, Poisson, OnOff };
+
+bool ParseAttackModel(const std::string &name, DaoAttackModel &out) {
+  if (name == "constant") { out = DaoAttackModel::Constant; return true; }
+  if (name == "burst") { out = DaoAttackModel::Burst; return true; }
+  if (name == "poisson") { out = DaoAttackModel::Poisson; return true; }
+  if (name == "onoff") { out = DaoAttackModel::OnOff; return true; }
+  return false;
+}
+
+// How attackers obtain their victims' DAOs:
+//   mirror: each victim sends a copy of every DAO to its attacker's mirror port (legacy)
+//   sniff:  the attacker taps the victim's transmissions (the victim node's IPv6 Tx
+//           trace, i.e. an eavesdropper on its first-hop link); victims send nothing extra
+enum class DaoCaptureMode { Mirror, Sniff };
+
+bool ParseCaptureMode(const std::string &name, DaoCaptureMode &out) {
+  if (name == "mirror") { out = DaoCaptureMode::Mirror; return true; }
+  if (name == "sniff") { out = DaoCaptureMode::Sniff; return true; }
+  return false;
+}
+
 class DaoAttackerApp : public Application {
 public:
   DaoAttackerApp()
-    : m_socket(0), m_listen(), m_peer(), m_payload(), m_replayCount(100), m_remaining(0), m_gap(Seconds(0.01)) {}
-  virtual ~DaoAttackerApp() { m_socket = 0; }
+    : m_socket(0), m_sendSocket(0), m_listen(), m_peer(), m_pool(std::make_shared<DaoPayloadPool>()), m_ring(1),
+      m_ringHead(0), m_ringSize(0), m_cursor(0), m_ringInfo(1), m_unreplayed(0), m_restorm(false),
+      m_replayCount(100), m_remaining(0), m_gap(Seconds(0.01)),
+      m_model(DaoAttackModel::Constant), m_batch(1), m_onTime(Seconds(0.5)), m_offTime(Seconds(0.5)),
+      m_interEvent(CreateObject<ExponentialRandomVariable>()),
+      m_logMode(DaoLogMode::Packet), m_logPeriod(Seconds(1.0)), m_logReplays(0) {}
+  virtual ~DaoAttackerApp() { m_socket = 0; m_sendSocket = 0; }
 
   void Setup(Address listen, Address forward, uint32_t count, Time gap) {
     m_listen = listen; m_peer = forward; m_replayCount = count; m_gap = gap;
   }
 
+  // Keep the last depth captured DAOs (from any victim mirroring to this attacker)
+  // and replay them round-robin. depth 1 replays the most recent capture only.
+  void SetCaptureDepth(uint32_t depth) {
+    m_ring.clear();
+    m_ring.resize(std::max<uint32_t>(depth, 1));
+    m_ringInfo.assign(m_ring.size(), RingInfo());
+  }
+
+  // Off (the original demo): one storm follows the first capture. On: a capture
+  // taken while no storm runs starts one, and a storm goes on while the ring holds
+  // captures it has not sent yet.
+  void SetRestorm(bool enable) { m_restorm = enable; }
+
+  // Captures are kept in buffers from pool, normally the one shared by the node's apps.
+  void SetPayloadPool(std::shared_ptr<DaoPayloadPool> pool) {
+    size_t depth = m_ring.size();
+    m_ring.clear(); // buffers go back to the previous pool
+    m_ring.resize(depth);
+    m_pool = std::move(pool);
+  }
+
+  // Call after Setup: poisson uses its gap as the mean. batch is ignored by the
+  // constant model; onTime/offTime only apply to onoff.
+  void SetTrafficModel(DaoAttackModel model, uint32_t batch, Time onTime, Time offTime) {
+    m_model = model; m_batch = std::max<uint32_t>(batch, 1); m_onTime = onTime; m_offTime = offTime;
+    m_interEvent->SetAttribute("Mean", DoubleValue(m_gap.GetSeconds()));
+  }
+
+  // Streams each attacker uses, from the one passed to AssignStreams.
+  static constexpr int64_t kStreams = 1;
+
+  // Fixes the replay-traffic stream; returns the number of streams used.
+  int64_t AssignStreams(int64_t stream) {
+    m_interEvent->SetStream(stream);
+    return kStreams;
+  }
+
+  // Summary mode folds replay batches into one line per period.
+  void SetLogMode(DaoLogMode mode, Time period) { m_logMode = mode; m_logPeriod = period; }
+
+  uint64_t Captured() const { return m_captured; }
+  uint64_t Replayed() const { return m_replayed; }
+
+  // Sniff capture: taps node's outgoing IPv6 traffic and keeps the DAOs sent to
+  // rootPort by victim, a sender key as the root would build it (ApplyDaoOrigin).
+  // Works alongside or instead of the mirror socket (Setup with listen = Address()).
+  void AddSniffTarget(Ptr<Node> node, const DaoSenderKey &victim, uint16_t rootPort) {
+    m_victims.push_back(victim);
+    m_sniffPort = rootPort;
+    if (std::find(m_tapped.begin(), m_tapped.end(), node) != m_tapped.end()) return;
+    m_tapped.push_back(node);
+    node->GetObject<Ipv6L3Protocol>()->TraceConnectWithoutContext("Tx", MakeCallback(&DaoAttackerApp::Sniff, this));
+  }
+
 private:
   virtual void StartApplication() override {
-    if (!m_socket) {
+    if (!m_socket && m_listen != Address()) {
       m_socket = Socket::CreateSocket(GetNode(), TypeId::LookupByName("ns3::UdpSocketFactory"));
       m_socket->Bind(m_listen);
       m_socket->SetRecvCallback(MakeCallback(&DaoAttackerApp::Capture, this));
     }
+    // Holds kReplayPort for the replays, so the capture binding is untouched.
+    if (!m_sendSocket) {
+      m_sendSocket = Socket::CreateSocket(GetNode(), TypeId::LookupByName("ns3::UdpSocketFactory"));
+      m_sendSocket->Bind(Inet6SocketAddress(Ipv6Address::GetAny(), kReplayPort));
+    }
+    m_ipv6 = GetNode()->GetObject<Ipv6L3Protocol>();
+    m_peerAddr = Inet6SocketAddress::ConvertFrom(m_peer).GetIpv6();
+    m_peerPort = Inet6SocketAddress::ConvertFrom(m_peer).GetPort();
   }
 
   virtual void StopApplication() override {
     if (m_socket) {
       m_socket->Close();
     }
+    if (m_sendSocket) {
+      m_sendSocket->Close();
+      m_sendSocket = 0; // stops sniff capture too
+    }
     if (m_replayEvent.IsPending()) Simulator::Cancel(m_replayEvent);
   }
 
@@ -145,289 +463,1677 @@ private:
     Address from; Ptr<Packet> pkt;
     while ((pkt = s->RecvFrom(from))) {
       uint32_t len = pkt->GetSize();
-      std::vector<uint8_t> buf(len);
-      pkt->CopyData(buf.data(), len);
-      std::string payload((char*)buf.data(), len);
-      if (m_payload.empty()) {
-        m_payload = payload;
-        m_remaining = m_replayCount;
-        // schedule a small delay before starting replay storm
-        m_replayEvent = Simulator::Schedule(Seconds(0.05), &DaoAttackerApp::ReplayOnce, this);
-        NS_LOG_WARN("Attacker (Sensor 0) captured DAO; starting replay storm...");
-      }
+      if (len == 0 || len > kDaoMaxWireSize) continue;
+      uint8_t buf[kDaoMaxWireSize];
+      pkt->CopyData(buf, len);
+      Store(buf, len, Inet6SocketAddress::ConvertFrom(from).GetIpv6());
     }
   }
 
-  void ReplayOnce() {
-    if (m_remaining == 0) return;
+  // Ipv6L3Protocol "Tx": the packet starts with the IPv6 header. Only a victim's
+  // UDP datagrams to the root are kept; DAOs carry no extension headers. The trace
+  // also fires for packets the node forwards (a tree descendant's DAOs, which its
+  // own tap captures), so the source must be one of the node's own addresses. The
+  // host is its own first victim, so its trace also sees this app's replays, which
+  // leave from kReplayPort and are skipped.
+  void Sniff(Ptr<const Packet> packet, Ptr<Ipv6> ipv6, uint32_t) {
+    if (!m_sendSocket) return; // not running
+    const uint32_t kHeaders = 40 + 8;
+    uint32_t size = packet->GetSize();
+    if (size <= kHeaders || size > kHeaders + kDaoMaxWireSize) return;
+    uint8_t buf[kHeaders + kDaoMaxWireSize];
+    packet->CopyData(buf, size);
+    if (buf[6] != 17 || ((uint32_t)buf[42] << 8 | buf[43]) != m_sniffPort) return;
+    if (((uint32_t)buf[40] << 8 | buf[41]) == kReplayPort) return;
+    Ipv6Address src = Ipv6Address::Deserialize(buf + 8);
+    if (ipv6->GetInterfaceForAddress(src) < 0) return; // forwarded
+    DaoSenderKey key;
+    std::memcpy(key.addr, buf + 8, sizeof(key.addr));
+    ApplyDaoOrigin(buf + kHeaders, size - kHeaders, key);
+    auto victim = [&key](const DaoSenderKey &v) { return std::memcmp(v.addr, key.addr, sizeof(key.addr)) == 0; };
+    if (std::none_of(m_victims.begin(), m_victims.end(), victim)) return;
+    Store(buf + kHeaders, size - kHeaders, src);
+  }
 
-    // Use a temporary send socket so we don't conflict with the receive socket binding.
-    Ptr<Socket> sendSocket = Socket::CreateSocket(GetNode(), TypeId::LookupByName("ns3::UdpSocketFactory"));
-    sendSocket->Bind(Inet6SocketAddress(Ipv6Address::GetAny(), 0));
+  // Keeps the capture's bytes and its victim's address only, so replays carry no
+  // packet tags. A ring slot takes a pooled buffer once and is overwritten in place
+  // from then on.
+  void Store(const uint8_t *buf, uint32_t len, Ipv6Address victim) {
+    ++m_captured;
+    DaoPayloadPool::Block &slot = m_ring[m_ringHead];
+    RingInfo &info = m_ringInfo[m_ringHead];
+    if (!slot) slot = m_pool->Acquire();
+    std::memcpy(slot.Data(), buf, len);
+    slot.SetSize(len);
+    if (!info.unreplayed) ++m_unreplayed;
+    info = RingInfo{true, victim};
+    m_ringHead = (m_ringHead + 1) % m_ring.size();
+    m_ringSize = std::min<uint32_t>(m_ringSize + 1, m_ring.size());
+    if (m_restorm ? !m_replayEvent.IsPending() && m_remaining == 0 : !m_stormStarted) {
+      m_stormStarted = true;
+      m_remaining = m_replayCount;
+      // schedule a small delay before starting replay storm
+      m_onEnd = Simulator::Now() + Seconds(0.05) + m_onTime;
+      m_logSince = Simulator::Now() + Seconds(0.05);
+      m_replayEvent = Simulator::Schedule(Seconds(0.05), &DaoAttackerApp::ReplayBatch, this);
+      NS_LOG_WARN("Attacker (Sensor " << GetNode()->GetId() << ") captured DAO; starting replay storm...");
+    }
+  }
+
+  void ReplayBatch() {
+    if (m_remaining == 0) return;
 
-    Ptr<Packet> pkt = Create<Packet>((uint8_t*)m_payload.c_str(), m_payload.size());
-    sendSocket->SendTo(pkt, 0, m_peer);
-    sendSocket->Close();
+    uint32_t n = m_model == DaoAttackModel::Constant ? 1 : std::min(m_batch, m_remaining);
+    for (uint32_t i = 0; i < n; ++i) {
+      const DaoPayloadPool::Block &capture = m_ring[m_cursor];
+      RingInfo &info = m_ringInfo[m_cursor];
+      SendAs(info.victim, Create<Packet>(capture.Data(), capture.Size()));
+      if (info.unreplayed) --m_unreplayed;
+      info.unreplayed = false;
+      m_cursor = (m_cursor + 1) % m_ringSize;
+    }
 
-    NS_LOG_WARN("Attacker (Sensor 0) replayed captured DAO, remaining=" << --m_remaining);
+    m_remaining -= n;
+    m_replayed += n;
+    // Keep storming while captures taken during this storm have not been sent yet.
+    if (m_restorm && m_remaining == 0 && m_unreplayed > 0) m_remaining = m_replayCount;
+    if (m_logMode == DaoLogMode::Packet) {
+      DAO_PKT_LOG(WARN, "Attacker (Sensor " << GetNode()->GetId() << ") replayed " << n << " captured DAO(s), remaining=" << m_remaining);
+    } else if (m_logMode == DaoLogMode::Summary) {
+      // Checked per batch, so a quiet attacker needs no timer; the tail is logged when the storm ends.
+      m_logReplays += n;
+      Time now = Simulator::Now();
+      if (now - m_logSince >= m_logPeriod || m_remaining == 0) {
+        NS_LOG_WARN("Attacker (Sensor " << GetNode()->GetId() << ") replayed " << m_logReplays << " DAO(s) in last "
+                    << (now - m_logSince).GetSeconds() << "s, remaining=" << m_remaining);
+        m_logReplays = 0;
+        m_logSince = now;
+      }
+    }
     if (m_remaining > 0) {
-      m_replayEvent = Simulator::Schedule(m_gap, &DaoAttackerApp::ReplayOnce, this);
+      m_replayEvent = Simulator::Schedule(NextGap(), &DaoAttackerApp::ReplayBatch, this);
     }
   }
 
-  Ptr<Socket> m_socket;
+  // A replay leaves with its victim's source address, so the root judges it against
+  // the victim's state. The UDP socket API cannot bind a foreign address, so the
+  // datagram goes straight to IPv6, which routes it as any local send. The source
+  // port is kReplayPort, which Sniff uses to recognise replays.
+  void SendAs(Ipv6Address victim, Ptr<Packet> packet) {
+    UdpHeader udp;
+    udp.SetSourcePort(kReplayPort);
+    udp.SetDestinationPort(m_peerPort);
+    if (Node::ChecksumEnabled()) {
+      udp.EnableChecksums();
+      udp.InitializeChecksum(victim, m_peerAddr, UdpL4Protocol::PROT_NUMBER);
+    }
+    packet->AddHeader(udp);
+    m_ipv6->Send(packet, victim, m_peerAddr, UdpL4Protocol::PROT_NUMBER, Ptr<Ipv6Route>());
+  }
+
+  Time NextGap() {
+    switch (m_model) {
+    case DaoAttackModel::Poisson:
+      return Seconds(m_interEvent->GetValue());
+    case DaoAttackModel::OnOff: {
+      Time next = Simulator::Now() + m_gap;
+      if (next < m_onEnd) return m_gap;
+      // Sit out the off period, then open the next on period.
+      Time wait = m_onEnd + m_offTime - Simulator::Now();
+      m_onEnd = Simulator::Now() + wait + m_onTime;
+      return wait;
+    }
+    default:
+      return m_gap;
+    }
+  }
+
+  // Source port of every replay: below the ephemeral range (49152 and up) the
+  // senders' sockets draw from, so no genuine DAO leaves from it.
+  static constexpr uint16_t kReplayPort = 12347;
+
+  Ptr<Socket> m_socket;      // capture (listen) socket
+  Ptr<Socket> m_sendSocket;  // reserves the replay source port
   Address m_listen;
   Address m_peer;
-  std::string m_payload;
+  Ptr<Ipv6L3Protocol> m_ipv6; // replays are handed to it directly (SendAs)
+  Ipv6Address m_peerAddr;
+  uint16_t m_peerPort = 0;
+  std::shared_ptr<DaoPayloadPool> m_pool; // declared before m_ring, which returns its buffers to it
+  std::vector<DaoPayloadPool::Block> m_ring; // fixed-capacity ring of captured DAOs
+  uint32_t m_ringHead;             // next slot to overwrite
+  uint32_t m_ringSize;             // filled slots
+  uint32_t m_cursor;               // round-robin replay position
+  struct RingInfo {
+    bool unreplayed = false;       // not sent since it was captured
+    Ipv6Address victim;            // source address of the capture
+  };
+  std::vector<RingInfo> m_ringInfo; // per ring slot
+  uint32_t m_unreplayed;           // slots not sent since their capture
+  bool m_restorm;
+  bool m_stormStarted = false;
   uint32_t m_replayCount;
   uint32_t m_remaining;
   Time m_gap;
   EventId m_replayEvent;
+  DaoAttackModel m_model;
+  uint32_t m_batch;
+  Time m_onTime;
+  Time m_offTime;
+  Time m_onEnd;                                // end of the current on period (onoff)
+  Ptr<ExponentialRandomVariable> m_interEvent; // poisson inter-event gaps
+  DaoLogMode m_logMode;
+  Time m_logPeriod;
+  Time m_logSince;                             // start of the current summary period
+  uint32_t m_logReplays;                       // replays since m_logSince
+  std::vector<DaoSenderKey> m_victims;         // sniff capture: whose DAOs to keep
+  std::vector<Ptr<Node>> m_tapped;             // nodes whose Tx trace is connected
+  uint16_t m_sniffPort = 0;
+  uint64_t m_captured = 0;                     // DAOs captured, either mode
+  uint64_t m_replayed = 0;                     // replays sent
 };
 
 // ---------------------- DaoRootReceiverApp (with metrics) -------------------------------
+
 class DaoRootReceiverApp : public Application {
 public:
   DaoRootReceiverApp()
     : m_socket(0),
       m_listen(),
       m_thresh(Seconds(0.2)),
-      m_totalDaos(0),
-      m_acceptedDaos(0),
-      m_rejectedDaos(0)
-  {}
+      m_validator(MakeFreshnessPolicy("hybrid", m_thresh.GetNanoSeconds())),
+      m_batchSize(1),
+      m_batchFill(0),
+      m_repeatRejects(0),
+      m_metrics(std::make_shared<DaoMetricsWriter>()),
+      m_logMode(DaoLogMode::Packet),
+      m_logPeriod(Seconds(1.0)),
+      m_profile(false)
+  {
+    m_metrics->Open("dao_metrics.csv", DaoMetricsFormat::Csv, DaoMetricsMode::Append);
+  }
 
   virtual ~DaoRootReceiverApp() {
     // Print and persist metrics when the application object is destroyed (after Simulator::Destroy)
-    // Avoid dividing by zero when no data exists
-    double avgDelay = 0.0;
-    uint64_t sampleCount = 0;
-    for (auto &kv : m_interArrivals) {
-      for (double d : kv.second) {
-        avgDelay += d;
-        ++sampleCount;
+    m_trace.Close();
+
+    // One tagged row per run; the writer adds the header to a new file
+    DaoMetricsRow row;
+    row.tags = m_runTags;
+    row.tags.emplace_back("freshness", m_validator.PolicyName());
+    row.tags.emplace_back("timestamp", UtcTimestamp());
+    m_validator.AppendMetrics(row.values);
+    if (m_batchSize > 1) row.values.emplace_back("repeat_rejects", (double)m_repeatRejects);
+    if (m_syncPeriod.IsStrictlyPositive()) {
+      row.values.insert(row.values.end(), {{"sync_msgs_sent", (double)m_syncMsgsSent},
+                                           {"sync_bytes_sent", (double)m_syncBytesSent},
+                                           {"sync_msgs_recv", (double)m_syncMsgsRecv},
+                                           {"sync_learned", (double)m_syncLearned}});
+    }
+    if (m_attackTotals) {
+      row.values.insert(row.values.end(), {{"attack_captured", (double)m_attackCaptured},
+                                           {"attack_replayed", (double)m_attackReplayed}});
+    }
+    if (m_profile) {
+      row.values.insert(row.values.end(), {{"decode_ns_mean", m_decodeCost.ns.mean},
+                                           {"decode_ns_p50", m_decodeCost.Quantile(0.50)},
+                                           {"decode_ns_p99", m_decodeCost.Quantile(0.99)},
+                                           {"check_ns_mean", m_checkCost.ns.mean},
+                                           {"check_ns_p50", m_checkCost.Quantile(0.50)},
+                                           {"check_ns_p99", m_checkCost.Quantile(0.99)}});
+      if (m_startupNodes) {
+        row.values.insert(row.values.end(), {{"startup_topology_ms", m_startupTopoNs / 1e6},
+                                             {"startup_apps_ms", m_startupAppsNs / 1e6}});
       }
     }
-    if (sampleCount > 0) avgDelay /= (double)sampleCount;
-
-    double rejectRatio = 0.0;
-    if (m_totalDaos > 0) rejectRatio = (double)m_rejectedDaos * 100.0 / (double)m_totalDaos;
-
-    // Append to CSV (create if missing)
-    std::ofstream out("dao_metrics.csv", std::ios::app);
-    if (out.is_open()) {
-      // Write a simple header if file is empty — best-effort (no atomic check for simplicity)
-      // We will always append a record row.
-      out << m_totalDaos << "," << m_acceptedDaos << "," << m_rejectedDaos << "," << std::fixed << std::setprecision(2) << rejectRatio << "," << avgDelay << "\n";
-      out.close();
+    // Roots sharing a writer write all their rows at once, when the last one goes.
+    m_metrics->Add(row);
+    if (m_metrics.use_count() == 1 && !m_metrics->Flush()) {
+      std::cerr << "Cannot write metrics to " << m_metrics->GetPath() << ": " << m_metrics->GetError() << std::endl;
     }
 
     // Console summary
     std::cout << std::endl;
     std::cout << "========== DAO Replay Mitigation Metrics ==========" << std::endl;
-    std::cout << "Total DAOs received: " << m_totalDaos << std::endl;
-    std::cout << "Accepted DAOs:       " << m_acceptedDaos << std::endl;
-    std::cout << "Rejected DAOs:       " << m_rejectedDaos << std::endl;
-    std::cout << "Replay rejection %:  " << std::fixed << std::setprecision(2) << rejectRatio << std::endl;
-    std::cout << "Average inter-arrival delay (s): " << avgDelay << std::endl;
+    if (!m_label.empty()) std::cout << "Root:                " << m_label << std::endl;
+    m_validator.PrintSummary(std::cout);
+    if (m_batchSize > 1) std::cout << "Repeats rejected without decoding: " << m_repeatRejects << std::endl;
+    if (m_syncPeriod.IsStrictlyPositive()) {
+      std::cout << "State sync: " << m_syncMsgsSent << " deltas sent (" << m_syncBytesSent << " bytes), "
+                << m_syncMsgsRecv << " received, " << m_syncLearned << " sender updates applied" << std::endl;
+    }
+    if (m_attackTotals) {
+      std::cout << "Attackers (all ranks): " << m_attackCaptured << " DAOs captured, " << m_attackReplayed
+                << " replays sent" << std::endl;
+    }
+    if (m_poolNodes) {
+      std::cout << "Payload pools (" << m_poolNodes << " nodes): " << m_pool.acquires << " buffers handed out, "
+                << m_pool.acquires - m_pool.releases << " still held, " << m_pool.slabs << " heap allocations ("
+                << m_pool.blocks << " buffers), largest node peak " << m_pool.peakInUse << " in use"
+                << std::endl;
+    }
+    if (m_startupNodes) {
+      std::cout << std::setprecision(1);
+      std::cout << "Startup (wall clock): " << m_startupTopoNs / 1e6 << " ms topology + " << m_startupAppsNs / 1e6
+                << " ms apps for " << m_startupNodes << " sensor nodes" << std::endl;
+    }
+    if (m_profile) {
+      std::cout << std::setprecision(1);
+      std::cout << "Decode cost mean / p50 / p99 (ns): " << m_decodeCost.ns.mean << " / "
+                << m_decodeCost.Quantile(0.50) << " / " << m_decodeCost.Quantile(0.99) << std::endl;
+      std::cout << "Check cost mean / p50 / p99 (ns):  " << m_checkCost.ns.mean << " / "
+                << m_checkCost.Quantile(0.50) << " / " << m_checkCost.Quantile(0.99) << std::endl;
+    }
     std::cout << "===================================================" << std::endl;
   }
 
   void Setup(Address listen, Time threshold) {
     m_listen = listen;
     m_thresh = threshold;
+    m_validator.SetPolicy(MakeFreshnessPolicy("hybrid", threshold.GetNanoSeconds()));
+  }
+
+  // Replaces the default hybrid policy installed by Setup.
+  void SetFreshnessPolicy(std::unique_ptr<FreshnessPolicy> policy) { m_validator.SetPolicy(std::move(policy)); }
+
+  // Output for the row the destructor writes, and the run tags leading that row.
+  void SetMetricsOutput(const std::string &path, DaoMetricsFormat format, DaoMetricsMode mode) {
+    m_metrics->Open(path, format, mode);
+  }
+  // One writer for several roots, each adding its own row (tell them apart by tag).
+  void SetMetricsOutput(std::shared_ptr<DaoMetricsWriter> writer) { m_metrics = std::move(writer); }
+  // Names this root in the console summary of a multi-root run.
+  void SetLabel(const std::string &label) { m_label = label; }
+  void SetRunTags(const std::vector<std::pair<std::string, std::string>> &tags) { m_runTags = tags; }
+
+  // Attacker totals reduced over every MPI rank; a distributed run's row and
+  // summary include them, since the attackers may live in other processes.
+  void SetAttackTotals(uint64_t captured, uint64_t replayed) {
+    m_attackTotals = true;
+    m_attackCaptured = captured;
+    m_attackReplayed = replayed;
+  }
+
+  // Payload-pool counters summed over the sensor nodes, for the summary; heap
+  // allocations that stop growing with the run length mean the senders and
+  // attackers reached steady state.
+  void SetPoolTotals(uint64_t nodes, const DaoPoolStats &stats) {
+    m_poolNodes = nodes;
+    m_pool = stats;
+  }
+
+  // Wall-clock setup cost of this process: building the topology (nodes, links,
+  // addresses, routes) and installing the apps, before the simulation starts.
+  void SetStartupCost(int64_t topologyNs, int64_t appsNs, uint32_t nodes) {
+    m_startupTopoNs = topologyNs;
+    m_startupAppsNs = appsNs;
+    m_startupNodes = nodes;
+  }
+
+  // Drains datagrams in batches of up to size, grouped by sender. A partial batch is
+  // judged once the socket is empty, or after coalesce when that is positive, which
+  // lets packets arriving close together share a batch. size <= 1 is per-packet mode.
+  void SetBatchReceive(uint32_t size, Time coalesce) {
+    m_batchSize = std::max<uint32_t>(size, 1);
+    m_coalesce = coalesce;
+    m_batch.resize(m_batchSize > 1 ? m_batchSize : 0);
+    m_batchOrder.resize(m_batch.size());
+  }
+
+  // Every period, sends the newest accepted state of the senders accepted since the
+  // last delta to each peer root, and folds the peers' deltas received on bind into
+  // the local state, so a DAO one root accepted is stale at all of them.
+  void EnableSync(Address bind, const std::vector<Address> &peers, Time period) {
+    m_syncBind = bind;
+    m_syncPeers = peers;
+    m_syncPeriod = period;
+  }
+
+  // Writes the anti-replay state and counters to path at time at (a DAO snapshot,
+  // see DaoSnapshotWriter); a partial receive batch is judged first.
+  void ScheduleSnapshot(Time at, const std::string &path) {
+    m_snapshotPath = path;
+    m_snapshotEvent = Simulator::Schedule(at, &DaoRootReceiverApp::SaveSnapshot, this);
+  }
+
+  // Replaces the state and counters with those of a snapshot, after the setters
+  // above: sender-table capacity and duplicate cache come from the snapshot, and
+  // the freshness policy must match. at receives the time it was taken. On
+  // failure, error says why.
+  bool LoadSnapshot(const std::string &path, Time &at, std::string &error) {
+    DaoSnapshotReader r;
+    int64_t atNs = 0;
+    bool ok = r.Open(path) && r.Get(atNs) && m_validator.Load(r) && r.Get(m_repeatRejects) &&
+              r.Get(m_syncMsgsSent) && r.Get(m_syncBytesSent) && r.Get(m_syncMsgsRecv) && r.Get(m_syncLearned) &&
+              r.GetArray(m_syncDirty) && r.GetArray(m_syncMarked);
+    if (ok && !r.AtEnd()) r.Fail("trailing data in snapshot");
+    error = r.Error();
+    at = NanoSeconds(atNs);
+    m_resumeNs = atNs;
+    return error.empty();
+  }
+
+  // After LoadSnapshot: senders resume overlap before the snapshot time, so DAOs in
+  // flight at that time are sent again; until overlap after it, the copies of DAOs
+  // the snapshot already accepted are dropped uncounted (see JudgedBeforeResume).
+  void SetResumeOverlap(Time overlap) { m_resumeOverlapEndNs = m_resumeNs + overlap.GetNanoSeconds(); }
+
+  // Rejects exact copies of recently accepted datagrams before decoding them;
+  // entries == 0 leaves the cache off.
+  void SetDupCache(uint32_t entries, Time maxAge) { m_validator.DupCache().SetCapacity(entries, maxAge.GetNanoSeconds()); }
+
+  // Caps the per-sender state at capacity entries with CLOCK eviction (0 = unbounded).
+  void SetSenderCapacity(uint32_t capacity, DaoEvictPolicy policy) {
+    m_validator.Senders().SetCapacity(capacity, policy);
+  }
+
+  // Record every datagram the root receives to path (see DAO trace files) for
+  // offline replay with dao-trace-replay. Returns false if path cannot be created.
+  bool EnableTrace(const std::string &path) { return m_trace.Open(path); }
+
+  // Measure real CPU time spent per DAO in decoding and in the sender lookup +
+  // freshness check, reported in the summary and as extra metrics columns.
+  void EnableProfiling(bool enable) { m_profile = enable; }
+
+  // Summary mode replaces the per-DAO ACCEPT/REJECT lines with per-sender counts
+  // logged once per period.
+  void SetLogMode(DaoLogMode mode, Time period) { m_logMode = mode; m_logPeriod = period; }
+
+  // Snapshot the counters every interval into a ring of capacity samples; a full ring
+  // is written to path (always appended, header on creation) in one batch.
+  void EnableSampling(Time interval, uint32_t capacity, const std::string &path, DaoMetricsFormat format) {
+    m_sampleInterval = interval;
+    m_samples.reserve(std::max<uint32_t>(capacity, 1));
+    m_sampleWriter.Open(path, format, DaoMetricsMode::Append);
   }
 
 private:
+  // One time-series point; per-sender rates are reduced to the busiest sender.
+  struct DaoSample {
+    double timeS;
+    uint64_t total, accepted, rejected;   // cumulative
+    uint64_t intervalTotal, intervalRejected;
+    uint32_t activeSenders;               // senders heard during the interval
+    uint32_t maxSenderDaos;               // DAOs from the busiest sender
+    uint32_t maxSenderSlot;
+  };
+
   virtual void StartApplication() override {
     if (!m_socket) {
       m_socket = Socket::CreateSocket(GetNode(), TypeId::LookupByName("ns3::UdpSocketFactory"));
       m_socket->Bind(m_listen);
       m_socket->SetRecvCallback(MakeCallback(&DaoRootReceiverApp::HandleRead, this));
     }
+    if (m_syncPeriod.IsStrictlyPositive() && !m_syncSocket) {
+      m_syncSocket = Socket::CreateSocket(GetNode(), TypeId::LookupByName("ns3::UdpSocketFactory"));
+      m_syncSocket->Bind(m_syncBind);
+      m_syncSocket->SetRecvCallback(MakeCallback(&DaoRootReceiverApp::HandleSync, this));
+      m_syncEvent = Simulator::Schedule(m_syncPeriod, &DaoRootReceiverApp::SendSync, this);
+    }
+    if (m_sampleInterval.IsStrictlyPositive()) {
+      m_sampleEvent = Simulator::Schedule(m_sampleInterval, &DaoRootReceiverApp::Sample, this);
+    }
+    if (m_logMode == DaoLogMode::Summary) {
+      m_logSince = Simulator::Now();
+      m_logEvent = Simulator::Schedule(m_logPeriod, &DaoRootReceiverApp::LogSummary, this);
+    }
   }
 
   virtual void StopApplication() override {
     if (m_socket) m_socket->Close();
+    if (m_batchFill) DrainBatch();
+    if (m_syncSocket) {
+      Simulator::Cancel(m_syncEvent);
+      m_syncSocket->Close();
+    }
+    if (m_snapshotEvent.IsPending()) Simulator::Cancel(m_snapshotEvent);
+    if (m_trace.IsOpen() && !m_trace.Flush()) std::cerr << "Cannot write DAO trace to " << m_trace.GetPath() << std::endl;
+    if (m_sampleEvent.IsPending()) Simulator::Cancel(m_sampleEvent);
+    if (m_sampleInterval.IsStrictlyPositive()) {
+      Sample();
+      Simulator::Cancel(m_sampleEvent);
+      FlushSamples();
+    }
+    if (m_logMode == DaoLogMode::Summary) {
+      LogSummary();
+      Simulator::Cancel(m_logEvent);
+    }
+  }
+
+  // One line per sender heard since the last summary; formatting cost is per
+  // period and sender, independent of the storm rate.
+  void LogSummary() {
+    double span = (Simulator::Now() - m_logSince).GetSeconds();
+    for (uint32_t slot = 0; slot < m_validator.Senders().Size(); ++slot) {
+      SenderState &st = m_validator.Senders().At(slot);
+      if (st.logAccepted == 0 && st.logRejected == 0) continue;
+      DaoSenderKey key = m_validator.Senders().KeyAt(slot);
+      Ipv6Address sender(key.addr);
+      if (st.logAccepted) NS_LOG_INFO("Root: accepted " << st.logAccepted << " DAOs from " << sender << " in last " << span << "s");
+      if (st.logRejected) NS_LOG_WARN("Root: rejected " << st.logRejected << " DAOs from " << sender << " in last " << span << "s");
+      st.logAccepted = 0;
+      st.logRejected = 0;
+    }
+    m_logSince = Simulator::Now();
+    m_logEvent = Simulator::Schedule(m_logPeriod, &DaoRootReceiverApp::LogSummary, this);
+  }
+
+  // Per-packet cost of sampling is the sampleDaos increment in HandleRead; the sender
+  // walk happens once per interval.
+  void Sample() {
+    DaoSample smp;
+    smp.timeS = Simulator::Now().GetSeconds();
+    smp.total = m_validator.Total();
+    smp.accepted = m_validator.Accepted();
+    smp.rejected = m_validator.Rejected();
+    const DaoSample *prev = m_samples.empty() ? &m_lastFlushed : &m_samples.back();
+    smp.intervalTotal = smp.total - prev->total;
+    smp.intervalRejected = smp.rejected - prev->rejected;
+    smp.activeSenders = 0;
+    smp.maxSenderDaos = 0;
+    smp.maxSenderSlot = 0;
+    for (uint32_t slot = 0; slot < m_validator.Senders().Size(); ++slot) {
+      SenderState &st = m_validator.Senders().At(slot);
+      if (st.sampleDaos == 0) continue;
+      ++smp.activeSenders;
+      if (st.sampleDaos > smp.maxSenderDaos) { smp.maxSenderDaos = st.sampleDaos; smp.maxSenderSlot = slot; }
+      st.sampleDaos = 0;
+    }
+    m_samples.push_back(smp);
+    if (m_samples.size() == m_samples.capacity()) FlushSamples();
+    m_sampleEvent = Simulator::Schedule(m_sampleInterval, &DaoRootReceiverApp::Sample, this);
+  }
+
+  void FlushSamples() {
+    if (m_samples.empty()) return;
+    std::string runId, rngRun;
+    for (const auto &t : m_runTags) {
+      if (t.first == "run_id") runId = t.second;
+      if (t.first == "rng_run") rngRun = t.second;
+    }
+    double intervalS = m_sampleInterval.GetSeconds();
+    for (const DaoSample &smp : m_samples) {
+      std::ostringstream busiest;
+      if (smp.maxSenderDaos > 0) {
+        DaoSenderKey key = m_validator.Senders().KeyAt(smp.maxSenderSlot);
+        busiest << Ipv6Address(key.addr);
+      }
+      DaoMetricsRow row;
+      row.tags = {{"run_id", runId}, {"rng_run", rngRun}, {"max_sender", busiest.str()}};
+      row.values = {{"time_s", smp.timeS},
+                    {"total", (double)smp.total},
+                    {"accepted", (double)smp.accepted},
+                    {"rejected", (double)smp.rejected},
+                    {"interval_total", (double)smp.intervalTotal},
+                    {"interval_rejected", (double)smp.intervalRejected},
+                    {"interval_reject_pct", smp.intervalTotal ? smp.intervalRejected * 100.0 / smp.intervalTotal : 0.0},
+                    {"active_senders", (double)smp.activeSenders},
+                    {"max_sender_rate", smp.maxSenderDaos / intervalS}};
+      m_sampleWriter.Add(row);
+    }
+    m_lastFlushed = m_samples.back();
+    m_samples.clear();
+    if (!m_sampleWriter.Flush()) {
+      std::cerr << "Cannot write samples to " << m_sampleWriter.GetPath() << ": " << m_sampleWriter.GetError() << std::endl;
+    }
   }
 
   void HandleRead(Ptr<Socket> s) {
     Address from; Ptr<Packet> pkt;
     while ((pkt = s->RecvFrom(from))) {
       uint32_t len = pkt->GetSize();
-      std::vector<uint8_t> buf(len);
-      pkt->CopyData(buf.data(), len);
-      std::string data((char*)buf.data(), len);
-
-      DaoPayload p;
-      if (!DeserializeDao(data, p)) {
-        NS_LOG_ERROR("Root: malformed DAO payload");
+      if (len > kDaoMaxWireSize) {
+        NS_LOG_ERROR("Root: oversized DAO payload (" << len << " bytes)");
         continue;
       }
+      int64_t nowNs = Simulator::Now().GetNanoSeconds();
+      DaoSenderKey key;
+      Inet6SocketAddress::ConvertFrom(from).GetIpv6().GetBytes(key.addr);
 
-      Ipv6Address sender = Inet6SocketAddress::ConvertFrom(from).GetIpv6();
-      Time now = Simulator::Now();
+      if (nowNs < m_resumeOverlapEndNs) {
+        pkt->CopyData(m_rxBuf, len);
+        if (JudgedBeforeResume(key, m_rxBuf, len)) continue;
+      }
 
-      // Metrics: inter-arrival per-sender
-      ++m_totalDaos;
-      if (m_prevArrival.count(sender) > 0) {
-        double delta = (now - m_prevArrival[sender]).GetSeconds();
-        m_interArrivals[sender].push_back(delta);
+      if (m_batchSize <= 1) {
+        // Decode straight out of the reusable scratch buffer: no per-datagram allocation.
+        pkt->CopyData(m_rxBuf, len);
+        if (m_trace.IsOpen()) m_trace.Add(nowNs, key, m_rxBuf, (uint16_t)len);
+        ApplyDaoOrigin(m_rxBuf, len, key);
+        Judge(key, m_rxBuf, len, nowNs);
+        continue;
       }
-      m_prevArrival[sender] = now;
-
-      bool accept = CheckFresh(sender, p, now);
-      if (accept) {
-        ++m_acceptedDaos;
-        NS_LOG_INFO("Root: ACCEPT DAO from " << sender << " seq=" << p.seq);
-      } else {
-        ++m_rejectedDaos;
-        NS_LOG_WARN("Root: REJECT DAO from " << sender << " seq=" << p.seq << " (replay detected)");
+
+      // Batch mode: park the datagram with its arrival time; verdicts come at drain.
+      RxEntry &e = m_batch[m_batchFill++];
+      e.key = key;
+      e.arrivalNs = nowNs;
+      e.len = len;
+      pkt->CopyData(e.wire, len);
+      if (m_trace.IsOpen()) m_trace.Add(nowNs, key, e.wire, (uint16_t)len);
+      ApplyDaoOrigin(e.wire, len, e.key);
+      if (m_batchFill == m_batchSize) DrainBatch();
+      else if (m_coalesce.IsStrictlyPositive() && !m_drainEvent.IsPending()) {
+        m_drainEvent = Simulator::Schedule(m_coalesce, &DaoRootReceiverApp::DrainBatch, this);
       }
     }
+    if (m_batchSize > 1 && !m_coalesce.IsStrictlyPositive()) DrainBatch();
   }
 
-  // Anti-replay logic (sequence + timestamp + burst window)
-  bool CheckFresh(const Ipv6Address &sender, const DaoPayload &p, Time arrivalTime) {
-    Time origTs = Seconds(p.tsSeconds) + NanoSeconds(p.tsNano);
-
-    if (m_lastSeq.count(sender) > 0) {
-      uint32_t lastSeq = m_lastSeq[sender];
-      Time lastOrig = m_lastOrig[sender];
-      Time lastArrival = m_lastArrival[sender];
+  // A resent DAO stamped before the snapshot time whose sender the snapshot had
+  // already accepted up to its seq. A pre-snapshot DAO rejected before the
+  // snapshot is judged again; so is (rarely) an old replay arriving in the overlap.
+  bool JudgedBeforeResume(const DaoSenderKey &from, const uint8_t *wire, uint32_t len) const {
+    DaoSenderKey key = from;
+    ApplyDaoOrigin(wire, len, key);
+    DaoPayload p;
+    uint32_t slot;
+    if (!DeserializeDao(wire, len, p) || !m_validator.Senders().Find(key, slot)) return false;
+    const SenderState &st = m_validator.Senders().At(slot);
+    int64_t origNs = DaoOrigNs(p);
+    return origNs < m_resumeNs && st.hasAccepted && p.seq <= st.lastSeq;
+  }
 
-      if (p.seq < lastSeq) {
-        // Old sequence — replay or stale
-        NS_LOG_DEBUG("Reject: seq < lastSeq");
-        return false;
-      }
+  // Decodes and judges one datagram (per-packet mode).
+  void Judge(const DaoSenderKey &key, const uint8_t *wire, uint32_t len, int64_t nowNs) {
+    uint32_t slot;
+    uint64_t fp = 0;
+    if (m_validator.RejectDuplicate(key, wire, len, nowNs, slot, fp)) {
+      Tally(slot, DaoVerdict::Duplicate, 0);
+      return;
+    }
+    int64_t t0 = m_profile ? WallClockNs() : 0;
+    DaoPayload p;
+    if (!DeserializeDao(wire, len, p)) {
+      NS_LOG_ERROR("Root: malformed DAO payload");
+      return;
+    }
+    int64_t t1 = m_profile ? WallClockNs() : 0;
+    DaoVerdict verdict = m_validator.Validate(key, p, nowNs, slot);
+    if (verdict == DaoVerdict::Accept) m_validator.RememberAccepted(fp, nowNs);
+    if (m_profile) {
+      m_decodeCost.Add(t1 - t0);
+      m_checkCost.Add(WallClockNs() - t1);
+    }
+    Tally(slot, verdict, p.seq);
+  }
 
-      if (p.seq == lastSeq) {
-        // Same sequence — could be duplicate or replay
-        if (origTs == lastOrig) {
-          NS_LOG_DEBUG("Reject: same seq and identical origTs");
-          return false;
+  // Judges the parked datagrams grouped by sender: each group resolves its sender
+  // slot once, and under a policy that RejectsRepeats, byte-identical copies of the
+  // group's newest accepted DAO that pass the duplicate cache, as in Judge, are
+  // rejected by memcmp without decoding. The stable sort keeps every sender's
+  // arrival order, so verdicts match per-packet mode.
+  void DrainBatch() {
+    if (m_drainEvent.IsPending()) Simulator::Cancel(m_drainEvent);
+    uint32_t n = m_batchFill;
+    m_batchFill = 0;
+    for (uint32_t i = 0; i < n; ++i) m_batchOrder[i] = i;
+    std::stable_sort(m_batchOrder.begin(), m_batchOrder.begin() + n, [this](uint32_t a, uint32_t b) {
+      return std::memcmp(m_batch[a].key.addr, m_batch[b].key.addr, sizeof(DaoSenderKey::addr)) < 0;
+    });
+    bool repeats = m_validator.RejectsRepeats();
+
+    for (uint32_t i = 0; i < n;) {
+      const DaoSenderKey &key = m_batch[m_batchOrder[i]].key;
+      bool resolved = false;
+      uint32_t slot = 0;
+      const RxEntry *newest = nullptr; // newest accepted DAO of this group, for the fast path
+      for (; i < n && std::memcmp(m_batch[m_batchOrder[i]].key.addr, key.addr, sizeof(key.addr)) == 0; ++i) {
+        const RxEntry &e = m_batch[m_batchOrder[i]];
+        uint64_t fp = 0;
+        if (m_validator.RejectDuplicate(key, e.wire, e.len, e.arrivalNs, slot, fp)) {
+          resolved = true;
+          Tally(slot, DaoVerdict::Duplicate, 0);
+          continue;
+        }
+        if (newest && e.len == newest->len && std::memcmp(e.wire, newest->wire, e.len) == 0) {
+          ++m_repeatRejects;
+          Tally(slot, m_validator.RejectRepeatAt(slot, e.arrivalNs), 0);
+          continue;
+        }
+        int64_t t0 = m_profile ? WallClockNs() : 0;
+        DaoPayload p;
+        if (!DeserializeDao(e.wire, e.len, p)) {
+          NS_LOG_ERROR("Root: malformed DAO payload");
+          continue;
+        }
+        int64_t t1 = m_profile ? WallClockNs() : 0;
+        bool firstContact = false;
+        if (!resolved) {
+          slot = m_validator.Lookup(key, firstContact);
+          resolved = true;
         }
-        if (arrivalTime - lastArrival < m_thresh) {
-          NS_LOG_DEBUG("Reject: arrival too fast after last (burst)");
-          return false;
+        DaoVerdict verdict = m_validator.ValidateAt(slot, firstContact, p, e.arrivalNs);
+        if (verdict == DaoVerdict::Accept) m_validator.RememberAccepted(fp, e.arrivalNs);
+        if (m_profile) {
+          m_decodeCost.Add(t1 - t0);
+          m_checkCost.Add(WallClockNs() - t1);
         }
+        if (verdict == DaoVerdict::Accept && repeats) {
+          const SenderState &st = m_validator.Senders().At(slot);
+          int64_t origNs = DaoOrigNs(p);
+          newest = st.lastSeq == p.seq && st.lastOrigNs == origNs ? &e : nullptr;
+        }
+        Tally(slot, verdict, p.seq);
+      }
+    }
+  }
+
+  void SaveSnapshot() {
+    if (m_batchFill) DrainBatch();
+    DaoSnapshotWriter w;
+    w.Put(Simulator::Now().GetNanoSeconds());
+    m_validator.Save(w);
+    w.Put(m_repeatRejects);
+    w.Put(m_syncMsgsSent);
+    w.Put(m_syncBytesSent);
+    w.Put(m_syncMsgsRecv);
+    w.Put(m_syncLearned);
+    w.PutArray(m_syncDirty);
+    w.PutArray(m_syncMarked);
+    if (w.WriteFile(m_snapshotPath)) {
+      NS_LOG_INFO("Root: snapshot of " << m_validator.Senders().Size() << " senders (" << w.Size() << " bytes) written to "
+                                       << m_snapshotPath);
+    } else {
+      std::cerr << "Cannot write snapshot to " << m_snapshotPath << std::endl;
+    }
+  }
+
+  // One delta per kDaoSyncMaxEntries senders accepted since the last one, to every
+  // peer. Learned state is never marked, so deltas do not echo between roots.
+  void SendSync() {
+    std::vector<DaoSyncEntry> &entries = m_syncEntries; // reused: grows to the largest delta once
+    entries.clear();
+    for (uint32_t slot : m_syncDirty) {
+      m_syncMarked[slot] = 0;
+      const SenderState &st = m_validator.Senders().At(slot);
+      if (st.hasAccepted) entries.push_back({m_validator.Senders().KeyAt(slot), st.lastSeq, st.lastOrigNs});
+    }
+    m_syncDirty.clear();
+    uint8_t buf[kDaoSyncMaxSize];
+    for (uint32_t i = 0; i < entries.size(); i += kDaoSyncMaxEntries) {
+      uint32_t len = SerializeDaoSync(entries.data() + i, entries.size() - i, buf);
+      for (const Address &peer : m_syncPeers) {
+        m_syncSocket->SendTo(Create<Packet>(buf, len), 0, peer);
+        ++m_syncMsgsSent;
+        m_syncBytesSent += len;
       }
+    }
+    m_syncEvent = Simulator::Schedule(m_syncPeriod, &DaoRootReceiverApp::SendSync, this);
+  }
+
+  void HandleSync(Ptr<Socket> s) {
+    Address from; Ptr<Packet> pkt;
+    uint8_t buf[kDaoSyncMaxSize];
+    while ((pkt = s->RecvFrom(from))) {
+      uint32_t len = pkt->GetSize();
+      if (len > kDaoSyncMaxSize) continue;
+      pkt->CopyData(buf, len);
+      ++m_syncMsgsRecv;
+      bool ok = ForEachDaoSyncEntry(buf, len, [this](const DaoSyncEntry &e) { m_syncLearned += m_validator.Learn(e); });
+      if (!ok) NS_LOG_ERROR("Root: malformed state-sync delta (" << len << " bytes)");
+    }
+  }
 
-      if (origTs < lastOrig) {
-        NS_LOG_DEBUG("Reject: origTs older than lastOrig");
-        return false;
+  // Per-sender bookkeeping and logging common to both receive modes; seq is 0 for
+  // repeats rejected without decoding.
+  void Tally(uint32_t slot, DaoVerdict verdict, uint32_t seq) {
+    SenderState &st = m_validator.Senders().At(slot);
+    ++st.sampleDaos;
+    if (verdict == DaoVerdict::Accept) {
+      ++st.logAccepted;
+      if (m_syncPeriod.IsStrictlyPositive()) {
+        if (slot >= m_syncMarked.size()) m_syncMarked.resize(slot + 1, 0);
+        if (!m_syncMarked[slot]) {
+          m_syncMarked[slot] = 1;
+          m_syncDirty.push_back(slot);
+        }
       }
+      if (m_logMode == DaoLogMode::Packet) DAO_PKT_LOG(INFO, "Root: ACCEPT DAO from " << SenderAddress(slot) << " seq=" << seq);
+    } else {
+      ++st.logRejected;
+      if (m_logMode == DaoLogMode::Packet) DAO_PKT_LOG(WARN, "Root: REJECT DAO from " << SenderAddress(slot) << " seq=" << seq << " (" << VerdictName(verdict) << ")");
     }
+  }
 
-    // Accept and update state
-    m_lastSeq[sender] = p.seq;
-    m_lastOrig[sender] = origTs;
-    m_lastArrival[sender] = arrivalTime;
-    return true;
+  Ipv6Address SenderAddress(uint32_t slot) const {
+    DaoSenderKey key = m_validator.Senders().KeyAt(slot);
+    return Ipv6Address(key.addr);
   }
 
   Ptr<Socket> m_socket;
   Address m_listen;
   Time m_thresh;
+  DaoValidator m_validator;         // anti-replay state, counters and inter-arrival stats
+  uint8_t m_rxBuf[kDaoMaxWireSize]; // receive scratch, reused for every datagram
+  DaoTraceWriter m_trace;           // optional record of received datagrams
+
+  // Batch receive mode (m_batchSize > 1)
+  struct RxEntry {
+    DaoSenderKey key;
+    int64_t arrivalNs;
+    uint32_t len;
+    uint8_t wire[kDaoMaxWireSize];
+  };
+  uint32_t m_batchSize;
+  Time m_coalesce;                  // how long a partial batch may wait
+  std::vector<RxEntry> m_batch;     // preallocated, m_batchFill in use
+  std::vector<uint32_t> m_batchOrder;
+  uint32_t m_batchFill;
+  EventId m_drainEvent;
+  uint64_t m_repeatRejects;         // rejected by the memcmp fast path
+
+  // State sync with peer roots (disabled while m_syncPeriod is zero)
+  Ptr<Socket> m_syncSocket;
+  Address m_syncBind;
+  std::vector<Address> m_syncPeers;
+  Time m_syncPeriod;
+  EventId m_syncEvent;
+  std::vector<uint32_t> m_syncDirty;  // slots accepted since the last delta
+  std::vector<uint8_t> m_syncMarked;  // per slot: already in m_syncDirty
+  std::vector<DaoSyncEntry> m_syncEntries;
+  uint64_t m_syncMsgsSent = 0;
+  uint64_t m_syncBytesSent = 0;
+  uint64_t m_syncMsgsRecv = 0;
+  uint64_t m_syncLearned = 0;         // entries that advanced a sender's state
+
+  std::string m_snapshotPath;
+  int64_t m_resumeNs = 0;             // time of the loaded snapshot
+  int64_t m_resumeOverlapEndNs = 0;   // see SetResumeOverlap
+  EventId m_snapshotEvent;
 
   // Metrics
-  uint32_t m_totalDaos;
-  uint32_t m_acceptedDaos;
-  uint32_t m_rejectedDaos;
-  std::map<Ipv6Address, Time> m_prevArrival;
-  std::map<Ipv6Address, std::vector<double>> m_interArrivals;
-
-  // Anti-replay state
-  std::map<Ipv6Address, uint32_t> m_lastSeq;
-  std::map<Ipv6Address, Time> m_lastOrig;
-  std::map<Ipv6Address, Time> m_lastArrival;
+  std::shared_ptr<DaoMetricsWriter> m_metrics;
+  std::string m_label;
+  std::vector<std::pair<std::string, std::string>> m_runTags;
+  bool m_attackTotals = false;
+  uint64_t m_attackCaptured = 0;
+  uint64_t m_attackReplayed = 0;
+  uint64_t m_poolNodes = 0;
+  DaoPoolStats m_pool;
+  int64_t m_startupTopoNs = 0;
+  int64_t m_startupAppsNs = 0;
+  uint32_t m_startupNodes = 0;
+
+  DaoLogMode m_logMode;
+  Time m_logPeriod;
+  Time m_logSince;
+  EventId m_logEvent;
+
+  // Processing-cost instrumentation (wall-clock ns per DAO)
+  bool m_profile;
+  StageCost m_decodeCost;   // copy out of the packet + DeserializeDao
+  StageCost m_checkCost;    // sender lookup, inter-arrival stats, freshness policy
+
+  // Time-series sampling (disabled while m_sampleInterval is zero)
+  Time m_sampleInterval;
+  EventId m_sampleEvent;
+  std::vector<DaoSample> m_samples;   // preallocated ring, flushed when full
+  DaoSample m_lastFlushed = {};       // baseline for the first interval after a flush
+  DaoMetricsWriter m_sampleWriter;
+};
+
+// ---------------------- Attacker placement --------------------------------
+// Sensor indices hosting an attacker: the first nAttackers sensors, nAttackers spread
+// evenly across the index range, or a uniformly random subset drawn from stream.
+std::vector<uint32_t> PlaceAttackers(uint32_t nSensors, uint32_t nAttackers, const std::string &placement,
+                                     int64_t stream) {
+  nAttackers = std::min(nAttackers, nSensors);
+  std::vector<uint32_t> hosts(nAttackers);
+  if (placement == "first") {
+    for (uint32_t a = 0; a < nAttackers; ++a) hosts[a] = a;
+  } else if (placement == "spread") {
+    for (uint32_t a = 0; a < nAttackers; ++a) hosts[a] = (uint32_t)((uint64_t)a * nSensors / nAttackers);
+  } else if (placement == "random") {
+    // Partial Fisher-Yates over the sensor indices.
+    std::vector<uint32_t> idx(nSensors);
+    for (uint32_t i = 0; i < nSensors; ++i) idx[i] = i;
+    Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable>();
+    rng->SetStream(stream);
+    for (uint32_t a = 0; a < nAttackers; ++a) {
+      std::swap(idx[a], idx[rng->GetInteger(a, nSensors - 1)]);
+      hosts[a] = idx[a];
+    }
+  } else {
+    NS_FATAL_ERROR("Unknown --attackerPlacement=" << placement);
+  }
+  return hosts;
+}
+
+// ---------------------- Topology builder ---------------------------------
+// star: one point-to-point link and /64 per sensor, all ending on the root (legacy).
+// csma: every node on one shared CSMA segment and /64; the root has a single device.
+// tree: sensors form a DODAG filled breadth-first with treeFanout children per node
+//       (up to treeDepth levels); each parent-child edge is a point-to-point /64,
+//       every node forwards, and static routes point upward by default and downward
+//       to each descendant subnet, so the root only holds treeFanout devices.
+// With several roots, every root branch (a star or csma sensor, a tree's top-level
+// subtree) is assigned to one root, round-robin (topology) or by a hash of the branch
+// index (hash), and in star and tree the roots share a CSMA backbone /64 for state
+// sync; on csma they already share the segment.
+enum class DaoTopologyMode { Star, Csma, Tree };
+enum class DaoRootAssign { Topology, Hash };
+
+bool ParseRootAssign(const std::string &name, DaoRootAssign &out) {
+  if (name == "topology") { out = DaoRootAssign::Topology; return true; }
+  if (name == "hash") { out = DaoRootAssign::Hash; return true; }
+  return false;
+}
+
+bool ParseTopologyMode(const std::string &name, DaoTopologyMode &out) {
+  if (name == "star") { out = DaoTopologyMode::Star; return true; }
+  if (name == "csma") { out = DaoTopologyMode::Csma; return true; }
+  if (name == "tree") { out = DaoTopologyMode::Tree; return true; }
+  return false;
+}
+
+struct DaoTopology {
+  NodeContainer nodes;                  // sensors 0..n-1, then the roots from index n
+  NodeContainer roots;
+  Ptr<Node> root;                       // the first root
+  Ipv6Address rootAddr;
+  std::vector<Ipv6Address> rootAddrs;   // address root r's sensors send their DAOs to
+  std::vector<Ipv6Address> syncAddrs;   // root r's address for state sync (backbone)
+  std::vector<uint32_t> rootOf;         // root of sensor i
+  std::vector<Ipv6Address> sensorAddrs; // sensor i's own (uplink) address
+  Time maxPathDelay;                    // bound on a DAO's sensor-to-root delay
 };
 
+class DaoTopologyBuilder {
+public:
+  DaoTopologyBuilder()
+    : m_mode(DaoTopologyMode::Star), m_fanout(4), m_maxDepth(0), m_ranks(1), m_roots(1),
+      m_assign(DaoRootAssign::Topology) {
+    m_p2p.SetDeviceAttribute("DataRate", StringValue("1Mbps"));
+    m_p2p.SetChannelAttribute("Delay", StringValue("5ms"));
+    m_csma.SetChannelAttribute("DataRate", StringValue("1Mbps"));
+    m_csma.SetChannelAttribute("Delay", StringValue("5ms"));
+  }
+
+  void SetMode(DaoTopologyMode mode) { m_mode = mode; }
+  // maxDepth == 0 leaves the depth unbounded.
+  void SetTreeShape(uint32_t fanout, uint32_t maxDepth) { m_fanout = fanout; m_maxDepth = maxDepth; }
+  // Spreads the nodes over ranks MPI ranks (node system ids); the root stays on rank 0.
+  void SetPartition(uint32_t ranks) { m_ranks = std::max<uint32_t>(ranks, 1); }
+  // Number of DODAG roots and how root branches are dealt to them.
+  void SetRoots(uint32_t roots, DaoRootAssign assign) { m_roots = std::max<uint32_t>(roots, 1); m_assign = assign; }
+
+  // Per-hop bound on a DAO's delay: the 5 ms link plus serialization and
+  // queueing behind a replay storm at 1 Mbps.
+  static Time HopDelayBound() { return MilliSeconds(5 + 100); }
+
+  DaoTopology Build(uint32_t nSensors) {
+    NS_ABORT_MSG_IF(nSensors == 0, "At least one sensor is required");
+    NS_ABORT_MSG_IF(m_ranks > 1 && m_mode == DaoTopologyMode::Csma,
+                    "A CSMA segment cannot span MPI ranks; use --topology=star or tree");
+    DaoTopology topo;
+    topo.rootOf.resize(nSensors);
+    std::vector<uint32_t> perRoot(m_roots, 0);
+    for (uint32_t i = 0; i < nSensors; ++i) ++perRoot[topo.rootOf[i] = RootOf(BranchOf(i))];
+    for (uint32_t r = 0; r < m_roots; ++r) {
+      NS_ABORT_MSG_IF(perRoot[r] == 0, "Root " << r << " of " << m_roots << " gets no sensors; use fewer roots"
+                      << (m_assign == DaoRootAssign::Hash ? " or --rootAssign=topology" : ""));
+    }
+    if (m_ranks == 1) {
+      topo.nodes.Create(nSensors + m_roots);
+    } else {
+      topo.nodes.Reserve(nSensors + m_roots);
+      for (uint32_t i = 0; i < nSensors; ++i) topo.nodes.Add(CreateObject<Node>(BranchOf(i) % m_ranks));
+      for (uint32_t r = 0; r < m_roots; ++r) topo.nodes.Add(CreateObject<Node>(0));
+    }
+    for (uint32_t r = 0; r < m_roots; ++r) topo.roots.Add(topo.nodes.Get(nSensors + r));
+    topo.root = topo.roots.Get(0);
+    topo.rootAddrs.resize(m_roots);
+    topo.sensorAddrs.resize(nSensors);
+    topo.maxPathDelay = HopDelayBound();  // one hop; BuildTree scales it by depth
+
+    // Every address is unique by construction, so skip duplicate address detection
+    // (a probe and a timer per address); nothing here speaks IPv4.
+    Config::SetDefault("ns3::Icmpv6L4Protocol::DAD", BooleanValue(false));
+    InternetStackHelper stack;
+    stack.SetIpv4StackInstall(false);
+    stack.Install(topo.nodes);
+
+    switch (m_mode) {
+    case DaoTopologyMode::Star: BuildStar(topo, nSensors); break;
+    case DaoTopologyMode::Csma: BuildCsma(topo, nSensors); break;
+    case DaoTopologyMode::Tree: BuildTree(topo, nSensors); break;
+    }
+    topo.rootAddr = topo.rootAddrs[0];
+    topo.syncAddrs = topo.rootAddrs;
+    if (m_roots > 1 && m_mode != DaoTopologyMode::Csma) {
+      NetDeviceContainer dev = m_csma.Install(topo.roots);
+      Ipv6InterfaceContainer ipc = AssignLink(dev, kBackboneLink);
+      for (uint32_t r = 0; r < m_roots; ++r) topo.syncAddrs[r] = ipc.GetAddress(r, 1);
+      // Mirrored DAOs may cross roots: each root reaches the other roots' sensor
+      // links through their backbone address.
+      Ipv6StaticRoutingHelper routing;
+      for (uint32_t r = 0; r < m_roots; ++r) {
+        ipc.SetForwarding(r, true);
+        Ptr<Ipv6StaticRouting> rt = routing.GetStaticRouting(topo.roots.Get(r)->GetObject<Ipv6>());
+        for (uint32_t i = 0; i < nSensors; ++i) {
+          if (topo.rootOf[i] == r) continue;
+          rt->AddNetworkRouteTo(Subnet(i), Ipv6Prefix(64), topo.syncAddrs[topo.rootOf[i]], ipc.GetInterfaceIndex(r));
+        }
+      }
+    }
+    return topo;
+  }
+
+private:
+  static constexpr uint32_t kBackboneLink = 0xffff0000; // subnet of the root backbone
+
+  // The root branch of a sensor. Whole branches go to one rank, so only the links
+  // into the root cross ranks (each a point-to-point link, remote when the ranks
+  // differ), and to one root. In a star every sensor is its own branch; in a tree,
+  // branch b holds the subtree under the root's child b.
+  uint32_t BranchOf(uint32_t sensor) const {
+    uint32_t branch = sensor;
+    if (m_mode == DaoTopologyMode::Tree && m_fanout > 0) {
+      while (branch >= m_fanout) branch = (branch - m_fanout) / m_fanout; // same parent rule as BuildTree
+    }
+    return branch;
+  }
+
+  uint32_t RootOf(uint32_t branch) const {
+    if (m_assign == DaoRootAssign::Topology) return branch % m_roots;
+    uint32_t h = branch * 0x9e3779b1u;
+    return (h ^ (h >> 16)) % m_roots;
+  }
+
+  // 2001:db8:<hi>:<lo>::/64 for link index (hi << 16 | lo).
+  static Ipv6Address Subnet(uint32_t index) {
+    uint8_t b[16] = {0x20, 0x01, 0x0d, 0xb8};
+    b[4] = index >> 24; b[5] = index >> 16; b[6] = index >> 8; b[7] = index;
+    return Ipv6Address(b);
+  }
+
+  // Ipv6AddressHelper::Assign on Subnet(link), minus the global address generator,
+  // whose collision check walks every range handed out so far (quadratic over one
+  // link per sensor). Links never share a subnet, so there is nothing to check.
+  static Ipv6InterfaceContainer AssignLink(const NetDeviceContainer &dev, uint32_t link) {
+    Ipv6InterfaceContainer ipc;
+    for (uint32_t d = 0; d < dev.GetN(); ++d) {
+      Ptr<NetDevice> device = dev.Get(d);
+      Ptr<Node> node = device->GetNode();
+      Ptr<Ipv6> ipv6 = node->GetObject<Ipv6>();
+      int32_t ifIndex = ipv6->GetInterfaceForDevice(device);
+      if (ifIndex == -1) ifIndex = ipv6->AddInterface(device);
+      ipv6->SetMetric(ifIndex, 1);
+      ipv6->AddAddress(ifIndex, Ipv6InterfaceAddress(Ipv6Address::MakeAutoconfiguredAddress(device->GetAddress(), Subnet(link)),
+                                                     Ipv6Prefix(64)));
+      ipv6->SetUp(ifIndex);
+      ipc.Add(ipv6, ifIndex);
+      // The default queue disc, as Assign installs it.
+      Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+      Ptr<NetDeviceQueueInterface> ndqi = device->GetObject<NetDeviceQueueInterface>();
+      if (tc && ndqi && !tc->GetRootQueueDiscOnDevice(device)) {
+        TrafficControlHelper::Default(ndqi->GetNTxQueues()).Install(device);
+      }
+    }
+    return ipc;
+  }
+
+  // Sensors get a single default route to their root; the root needs none, all its
+  // links are on-link, and it forwards mirrored DAOs between its sensors.
+  void BuildStar(DaoTopology &topo, uint32_t nSensors) {
+    Ipv6StaticRoutingHelper routing;
+    for (uint32_t i = 0; i < nSensors; ++i) {
+      uint32_t r = topo.rootOf[i];
+      NetDeviceContainer dev = m_p2p.Install(topo.nodes.Get(i), topo.roots.Get(r));
+      Ipv6InterfaceContainer ipc = AssignLink(dev, i);
+      ipc.SetForwarding(0, true);
+      ipc.SetForwarding(1, true);
+      if (topo.rootAddrs[r].IsAny()) topo.rootAddrs[r] = ipc.GetAddress(1, 1);
+      topo.sensorAddrs[i] = ipc.GetAddress(0, 1);
+      routing.GetStaticRouting(topo.nodes.Get(i)->GetObject<Ipv6>())
+        ->SetDefaultRoute(ipc.GetAddress(1, 1), ipc.GetInterfaceIndex(0));
+    }
+  }
+
+  void BuildCsma(DaoTopology &topo, uint32_t nSensors) {
+    NetDeviceContainer dev = m_csma.Install(topo.nodes);
+    Ipv6InterfaceContainer ipc = AssignLink(dev, 0);
+    for (uint32_t r = 0; r < m_roots; ++r) topo.rootAddrs[r] = ipc.GetAddress(nSensors + r, 1);
+    for (uint32_t i = 0; i < nSensors; ++i) topo.sensorAddrs[i] = ipc.GetAddress(i, 1);
+  }
+
+  void BuildTree(DaoTopology &topo, uint32_t nSensors) {
+    NS_ABORT_MSG_IF(m_fanout == 0, "treeFanout must be positive");
+    // Breadth-first fill: sensor i hangs off the root when i < fanout, otherwise
+    // off sensor (i - fanout) / fanout. kRootIdx marks the branch's root as parent.
+    const uint32_t kRootIdx = nSensors;
+    std::vector<uint32_t> parent(nSensors), depth(nSensors);
+    for (uint32_t i = 0; i < nSensors; ++i) {
+      parent[i] = i < m_fanout ? kRootIdx : (i - m_fanout) / m_fanout;
+      depth[i] = parent[i] == kRootIdx ? 1 : depth[parent[i]] + 1;
+      NS_ABORT_MSG_IF(m_maxDepth != 0 && depth[i] > m_maxDepth,
+                      "nSensors=" << nSensors << " does not fit a tree of fanout " << m_fanout
+                      << " and depth " << m_maxDepth);
+    }
+    topo.maxPathDelay = HopDelayBound() * (int64_t)depth.back();  // breadth-first: the last is deepest
+
+    // Sensor i's uplink is link i: device 0 is the sensor, device 1 its parent.
+    Ipv6StaticRoutingHelper routing;
+    std::vector<Ipv6Address> upAddr(nSensors), parentAddr(nSensors);
+    std::vector<uint32_t> parentIf(nSensors);
+    auto nodeOf = [&](uint32_t idx, uint32_t sensor) {
+      return idx == kRootIdx ? topo.roots.Get(topo.rootOf[sensor]) : topo.nodes.Get(idx);
+    };
+    for (uint32_t i = 0; i < nSensors; ++i) {
+      Ptr<Node> up = nodeOf(parent[i], i);
+      NetDeviceContainer dev = m_p2p.Install(topo.nodes.Get(i), up);
+      Ipv6InterfaceContainer ipc = AssignLink(dev, i);
+      ipc.SetForwarding(0, true);
+      ipc.SetForwarding(1, true);
+      upAddr[i] = ipc.GetAddress(0, 1);
+      parentAddr[i] = ipc.GetAddress(1, 1);
+      parentIf[i] = ipc.GetInterfaceIndex(1);
+      topo.sensorAddrs[i] = upAddr[i];
+      if (parent[i] == kRootIdx && topo.rootAddrs[topo.rootOf[i]].IsAny()) topo.rootAddrs[topo.rootOf[i]] = parentAddr[i];
+      routing.GetStaticRouting(topo.nodes.Get(i)->GetObject<Ipv6>())
+        ->SetDefaultRoute(parentAddr[i], ipc.GetInterfaceIndex(0));
+    }
+
+    // Downward routes: every ancestor above the direct parent reaches link i through
+    // the child on the path, i.e. O(nSensors * depth) routes in total.
+    for (uint32_t i = 0; i < nSensors; ++i) {
+      uint32_t via = parent[i];
+      while (via != kRootIdx) {
+        uint32_t anc = parent[via];
+        routing.GetStaticRouting(nodeOf(anc, i)->GetObject<Ipv6>())
+          ->AddNetworkRouteTo(Subnet(i), Ipv6Prefix(64), upAddr[via], parentIf[via]);
+        via = anc;
+      }
+    }
+  }
+
+  DaoTopologyMode m_mode;
+  uint32_t m_fanout;
+  uint32_t m_maxDepth;
+  uint32_t m_ranks;
+  uint32_t m_roots;
+  DaoRootAssign m_assign;
+  PointToPointHelper m_p2p;
+  CsmaHelper m_csma;
+};
+
+// ---------------------- Parameter sweep runner ---------------------------
+// --sweep="nSensors=3,50;threshold=0.1,0.2" expands to the cartesian product of the
+// listed values. Every grid point runs --replications times, each replication in its
+// own child process (a fresh copy of this binary, so simulators stay isolated) with
+// a distinct --RngRun. At most --jobs children run at once. Each child tags its row
+// with its --runId and the swept values (--runTags, as sweep_<name> columns) and
+// writes it atomically to a private file under <sweepOut>.d/; the parent then
+// concatenates those files, which all share one schema, into sweepOut.
+struct SweepParam {
+  std::string name;
+  std::vector<std::string> values;
+};
+
+std::vector<SweepParam> ParseSweepSpec(const std::string &spec) {
+  std::vector<SweepParam> params;
+  std::istringstream iss(spec);
+  std::string item;
+  while (std::getline(iss, item, ';')) {
+    if (item.empty()) continue;
+    size_t eq = item.find('=');
+    NS_ABORT_MSG_IF(eq == std::string::npos || eq == 0 || eq + 1 == item.size(), "Malformed --sweep entry: " << item);
+    SweepParam param;
+    param.name = item.substr(0, eq);
+    std::istringstream vals(item.substr(eq + 1));
+    std::string v;
+    while (std::getline(vals, v, ',')) {
+      if (!v.empty()) param.values.push_back(v);
+    }
+    NS_ABORT_MSG_IF(param.values.empty(), "No values for --sweep parameter " << param.name);
+    params.push_back(param);
+  }
+  NS_ABORT_MSG_IF(params.empty(), "Empty --sweep specification");
+  return params;
+}
+
+// Arguments of the parent that are forwarded unchanged to every child.
+static bool IsSweepControlArg(const std::string &arg) {
+  static const char *kControl[] = {"--sweep=", "--replications=", "--jobs=", "--sweepOut=", "--metricsFile=",
+                                   "--metricsMode=", "--RngRun=", "--runId=", "--runTags="};
+  for (const char *prefix : kControl) {
+    if (arg.compare(0, std::strlen(prefix), prefix) == 0) return true;
+  }
+  return false;
+}
+
+int RunSweep(int argc, char *argv[], const std::string &spec, uint32_t replications, uint32_t jobs,
+             const std::string &outPath, DaoMetricsFormat format) {
+  std::vector<SweepParam> params = ParseSweepSpec(spec);
+  replications = std::max<uint32_t>(replications, 1);
+  if (jobs == 0) jobs = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+
+  std::string exe = access("/proc/self/exe", X_OK) == 0 ? "/proc/self/exe" : argv[0];
+  std::vector<std::string> common;
+  for (int i = 1; i < argc; ++i) {
+    if (!IsSweepControlArg(argv[i])) common.push_back(argv[i]);
+  }
+
+  std::string dir = outPath + ".d";
+  NS_ABORT_MSG_IF(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST, "Cannot create sweep directory " << dir);
+
+  struct SweepRun {
+    uint32_t id;
+    uint64_t rngRun;
+    std::vector<std::string> values;
+    pid_t pid;
+    int status;
+  };
+  std::vector<SweepRun> runs;
+  uint64_t points = 1;
+  for (const SweepParam &param : params) points *= param.values.size();
+  uint64_t baseRun = RngSeedManager::GetRun();
+  for (uint64_t point = 0; point < points; ++point) {
+    std::vector<std::string> values;
+    uint64_t rest = point;
+    for (const SweepParam &param : params) {
+      values.push_back(param.values[rest % param.values.size()]);
+      rest /= param.values.size();
+    }
+    for (uint32_t rep = 0; rep < replications; ++rep) {
+      uint32_t id = runs.size();
+      runs.push_back({id, baseRun + id, values, -1, -1});
+    }
+  }
+
+  const char *ext = format == DaoMetricsFormat::Csv ? ".csv" : ".bin";
+  auto runFile = [&dir](uint32_t id, const char *ext) {
+    std::ostringstream oss;
+    oss << dir << "/run-" << id << ext;
+    return oss.str();
+  };
+
+  auto launch = [&](SweepRun &run) {
+    std::vector<std::string> args(1, exe);
+    args.insert(args.end(), common.begin(), common.end());
+    std::string tags;
+    for (size_t i = 0; i < params.size(); ++i) {
+      args.push_back("--" + params[i].name + "=" + run.values[i]);
+      tags += (i ? ";" : "") + params[i].name + "=" + run.values[i];
+    }
+    args.push_back("--RngRun=" + std::to_string(run.rngRun));
+    args.push_back("--runId=" + std::to_string(run.id));
+    args.push_back("--runTags=" + tags);
+    args.push_back("--metricsFile=" + runFile(run.id, ext));
+    args.push_back("--metricsMode=replace");
+    std::string log = runFile(run.id, ".log");
+    unlink(runFile(run.id, ext).c_str()); // a stale file would hide a failed run
+
+    std::vector<char *> cargv;
+    for (std::string &a : args) cargv.push_back(&a[0]);
+    cargv.push_back(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+      int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0) { dup2(fd, STDOUT_FILENO); dup2(fd, STDERR_FILENO); close(fd); }
+      execv(exe.c_str(), cargv.data());
+      _exit(127);
+    }
+    NS_ABORT_MSG_IF(pid < 0, "fork failed for sweep run " << run.id);
+    run.pid = pid;
+  };
+
+  std::cout << "Sweep: " << runs.size() << " runs (" << points << " grid points x " << replications
+            << " replications) on " << jobs << " workers" << std::endl;
+  size_t next = 0, active = 0, done = 0;
+  while (done < runs.size()) {
+    while (active < jobs && next < runs.size()) {
+      launch(runs[next++]);
+      ++active;
+    }
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) break;
+    for (SweepRun &run : runs) {
+      if (run.pid == pid) { run.status = status; break; }
+    }
+    --active;
+    ++done;
+  }
+
+  std::vector<std::string> outputs;
+  uint32_t failed = 0;
+  for (const SweepRun &run : runs) {
+    struct stat st;
+    bool ok = WIFEXITED(run.status) && WEXITSTATUS(run.status) == 0 && stat(runFile(run.id, ext).c_str(), &st) == 0;
+    if (ok) {
+      outputs.push_back(runFile(run.id, ext));
+    } else {
+      ++failed;
+      std::cerr << "Sweep run " << run.id << " failed; see " << runFile(run.id, ".log") << std::endl;
+    }
+  }
+  uint32_t merged = MergeMetricsFiles(outputs, outPath, format);
+  failed += outputs.size() - merged;
+  std::cout << "Sweep: merged " << merged << " of " << runs.size() << " runs into " << outPath << std::endl;
+  return failed == 0 ? 0 : 1;
+}
+
 // ---------------------- main ---------------------------------------------
 int main(int argc, char *argv[]) {
   CommandLine cmd;
   uint32_t nSensors = 3;
   bool enableAttacker = true;
   double simTime = 25.0;
+  std::string wireFormatName = "binary";
+  std::string freshnessName = "hybrid";
+  double threshold = 0.2;
+  std::string topologyName = "star";
+  uint32_t treeFanout = 4;
+  uint32_t treeDepth = 0;
+  std::string attackModelName = "constant";
+  uint32_t replayCount = 100;
+  double replayGap = 0.01;
+  uint32_t replayBatch = 10;
+  double attackOnTime = 0.5;
+  double attackOffTime = 0.5;
+  uint32_t nAttackers = 1;
+  std::string attackerPlacement = "first";
+  std::string captureModeName = "mirror";
+  uint32_t victimsPerAttacker = 1;
+  uint32_t captureDepth = 1;
+  std::string metricsFile = "dao_metrics.csv";
+  std::string sweepSpec;
+  uint32_t replications = 1;
+  uint32_t jobs = 0;
+  std::string sweepOut = "dao_sweep.csv";
+  std::string metricsFormatName = "csv";
+  std::string metricsModeName = "append";
+  uint32_t runId = 0;
+  std::string runTags;
+  double sampleInterval = 0.0;
+  uint32_t sampleBuffer = 1024;
+  std::string sampleFile = "dao_timeseries.csv";
+  std::string logModeName = "packet";
+  double logPeriod = 1.0;
+  bool profileRoot = false;
+  bool distributed = false;
+  std::string traceOut;
+  uint32_t senderCapacity = 0;
+  std::string evictPolicyName = "fresh-ts";
+  uint32_t rxBatch = 1;
+  uint32_t dupCache = 0;
+  double dupCacheAge = 10.0;
+  double rxCoalesce = 0.0;
+  uint32_t sensorsPerNode = 1;
+  double aggTick = 0.001;
+  uint32_t nRoots = 1;
+  std::string rootAssignName = "topology";
+  double syncPeriod = 0.0;
+  double snapshotAt = 0.0;
+  std::string snapshotOut = "dao_snapshot.bin";
+  std::string resumeFrom;
   cmd.AddValue("nSensors", "Number of sensors (excluding root)", nSensors);
-  cmd.AddValue("enableAttacker", "Enable attacker (Sensor 0)", enableAttacker);
+  cmd.AddValue("enableAttacker", "Enable the attackers (Sensor 0 by default)", enableAttacker);
+  cmd.AddValue("nAttackers", "Number of compromised sensors running an attacker", nAttackers);
+  cmd.AddValue("attackerPlacement", "Attacker hosts: first, spread or random", attackerPlacement);
+  cmd.AddValue("victimsPerAttacker", "Sensors (including its host) each attacker captures from", victimsPerAttacker);
+  cmd.AddValue("captureMode", "How attackers capture their victims' DAOs: mirror or sniff", captureModeName);
+  cmd.AddValue("captureDepth", "Captured DAOs each attacker keeps and replays round-robin", captureDepth);
+  cmd.AddValue("sensorsPerNode", "Logical sensors per sensor node, sharing one aggregate sender; 1 = one app per node", sensorsPerNode);
+  cmd.AddValue("aggTick", "Timer-wheel tick of the aggregate senders (s)", aggTick);
+  cmd.AddValue("nRoots", "DODAG roots (border routers) sharing the sensors", nRoots);
+  cmd.AddValue("rootAssign", "How root branches are dealt to the roots: topology (round-robin) or hash", rootAssignName);
+  cmd.AddValue("syncPeriod", "Period (s) of the roots' per-sender state-sync deltas; 0 = no sync", syncPeriod);
   cmd.AddValue("simTime", "Simulation time (s)", simTime);
+  cmd.AddValue("wireFormat", "DAO payload encoding sent by sensors: binary or text", wireFormatName);
+  cmd.AddValue("freshness", "Root freshness policy: hybrid or '+'-joined parts from seq|window64|window128|window1024, ts, burst", freshnessName);
+  cmd.AddValue("threshold", "Burst threshold of the root freshness check (s)", threshold);
+  cmd.AddValue("topology", "Network layout: star, csma or tree", topologyName);
+  cmd.AddValue("treeFanout", "Children per node in the tree topology", treeFanout);
+  cmd.AddValue("treeDepth", "Maximum tree depth (0 = unbounded)", treeDepth);
+  cmd.AddValue("attackModel", "Replay traffic model: constant, burst, poisson or onoff", attackModelName);
+  cmd.AddValue("replayCount", "Replays sent per storm", replayCount);
+  cmd.AddValue("replayGap", "Gap between replay events (s); mean gap for poisson", replayGap);
+  cmd.AddValue("replayBatch", "Replays emitted per event (burst, poisson, onoff)", replayBatch);
+  cmd.AddValue("attackOnTime", "On period of the onoff model (s)", attackOnTime);
+  cmd.AddValue("attackOffTime", "Off period of the onoff model (s)", attackOffTime);
+  cmd.AddValue("metricsFile", "File the root writes its tagged metrics row to", metricsFile);
+  cmd.AddValue("metricsFormat", "Metrics encoding: csv or bin", metricsFormatName);
+  cmd.AddValue("metricsMode", "append (locked, shared file) or replace (temp file + rename)", metricsModeName);
+  cmd.AddValue("runId", "Run identifier recorded in the metrics row", runId);
+  cmd.AddValue("runTags", "Extra metrics tags as \"name=value;...\" (sweep_<name> columns)", runTags);
+  cmd.AddValue("sampleInterval", "Time-series sampling period at the root (s); 0 disables", sampleInterval);
+  cmd.AddValue("sampleBuffer", "Samples buffered in memory before each batch write", sampleBuffer);
+  cmd.AddValue("sampleFile", "File the time series is appended to (format: --metricsFormat)", sampleFile);
+  cmd.AddValue("logMode", "Traffic logging at the root and attackers: packet, summary or off", logModeName);
+  cmd.AddValue("senderCapacity", "Max senders the root keeps state for, with CLOCK eviction; 0 = unbounded", senderCapacity);
+  cmd.AddValue("evictPolicy", "What the root keeps of evicted senders: fresh-ts or forget", evictPolicyName);
+  cmd.AddValue("dupCache", "Entries in the root's cache of accepted payload fingerprints (used only when --freshness rejects repeats); 0 = off", dupCache);
+  cmd.AddValue("dupCacheAge", "Seconds a fingerprint keeps rejecting exact copies", dupCacheAge);
+  cmd.AddValue("rxBatch", "Datagrams the root judges per batch, grouped by sender; 1 = per packet", rxBatch);
+  cmd.AddValue("rxCoalesce", "Max wait (s) before a partial receive batch is judged; 0 = when the socket is empty", rxCoalesce);
+  cmd.AddValue("snapshotAt", "Time (s) at which the root saves its anti-replay state to --snapshotOut; 0 = never", snapshotAt);
+  cmd.AddValue("snapshotOut", "Snapshot file written at --snapshotAt", snapshotOut);
+  cmd.AddValue("resumeFrom", "Resume from a snapshot: root state as saved, traffic from the snapshot time on", resumeFrom);
+  cmd.AddValue("traceOut", "Record every DAO received by the root to this file for dao-trace-replay", traceOut);
+  cmd.AddValue("profileRoot", "Measure wall-clock decode/check cost per DAO at the root", profileRoot);
+  cmd.AddValue("logPeriod", "Aggregation period of --logMode=summary (s)", logPeriod);
+  cmd.AddValue("distributed", "Run on ns-3's MPI distributed simulator (under mpirun), root on rank 0", distributed);
+  cmd.AddValue("sweep", "Parameter grid, e.g. \"nSensors=3,50;threshold=0.1,0.2\" (runs a sweep)", sweepSpec);
+  cmd.AddValue("replications", "Sweep replications per grid point, each with its own RngRun", replications);
+  cmd.AddValue("jobs", "Concurrent sweep processes (0 = one per core)", jobs);
+  cmd.AddValue("sweepOut", "Merged, tagged CSV written by a sweep", sweepOut);
   cmd.Parse(argc, argv);
 
-  // nodes: sensors (0..nSensors-1) + root (nSensors)
-  NodeContainer nodes;
-  nodes.Create(nSensors + 1);
-  Ptr<Node> root = nodes.Get(nSensors);     // root node
-  Ptr<Node> attackerNode = nodes.Get(0);    // attacker resides on sensor 0
-
-  PointToPointHelper p2p;
-  p2p.SetDeviceAttribute("DataRate", StringValue("1Mbps"));
-  p2p.SetChannelAttribute("Delay", StringValue("5ms"));
-
-  InternetStackHelper stack;
-  stack.Install(nodes);
-
-  Ipv6AddressHelper ipv6;
-  std::vector<Ipv6InterfaceContainer> ifs;
-  for (uint32_t i = 0; i < nSensors; ++i) {
-    NodeContainer link;
-    link.Add(nodes.Get(i));
-    link.Add(root);
-    NetDeviceContainer dev = p2p.Install(link);
-    std::ostringstream subnet;
-    subnet << "2001:db8:0:" << i << "::";
-    ipv6.SetBase(Ipv6Address(subnet.str().c_str()), Ipv6Prefix(64));
-    Ipv6InterfaceContainer ipc = ipv6.Assign(dev);
-    ipc.SetForwarding(0, true);
-    ipc.SetDefaultRouteInAllNodes(0);
-    ifs.push_back(ipc);
-  }
-
-  Ipv6Address rootAddr = ifs[0].GetAddress(1, 1);
-  Ipv6Address sensor0Addr = ifs[0].GetAddress(0, 1); // sensor 0 IP
+  DaoMetricsFormat metricsFormat;
+  NS_ABORT_MSG_UNLESS(ParseMetricsFormat(metricsFormatName, metricsFormat), "Unknown --metricsFormat=" << metricsFormatName);
+  DaoMetricsMode metricsMode;
+  NS_ABORT_MSG_UNLESS(ParseMetricsMode(metricsModeName, metricsMode), "Unknown --metricsMode=" << metricsModeName);
+
+  // Distributed execution: ranks share the topology, the root is on rank 0 and the
+  // links into it carry the cross-rank traffic (see DaoTopologyBuilder::RankOf).
+  uint32_t nRanks = 1, rank = 0;
+  if (distributed) {
+    NS_ABORT_MSG_UNLESS(sweepSpec.empty(), "--distributed cannot drive a --sweep");
+#ifdef NS3_MPI
+    GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(&argc, &argv);
+    nRanks = MpiInterface::GetSize();
+    rank = MpiInterface::GetSystemId();
+#else
+    NS_FATAL_ERROR("--distributed needs ns-3 built with MPI (./ns3 configure --enable-mpi)");
+#endif
+  }
+
+  if (!sweepSpec.empty()) return RunSweep(argc, argv, sweepSpec, replications, jobs, sweepOut, metricsFormat);
+
+  DaoWireFormat wireFormat;
+  NS_ABORT_MSG_UNLESS(ParseWireFormat(wireFormatName, wireFormat), "Unknown --wireFormat=" << wireFormatName);
+
+  DaoAttackModel attackModel;
+  NS_ABORT_MSG_UNLESS(ParseAttackModel(attackModelName, attackModel), "Unknown --attackModel=" << attackModelName);
+  DaoCaptureMode captureMode;
+  NS_ABORT_MSG_UNLESS(ParseCaptureMode(captureModeName, captureMode), "Unknown --captureMode=" << captureModeName);
+  DaoEvictPolicy evictPolicy;
+  NS_ABORT_MSG_UNLESS(ParseEvictPolicy(evictPolicyName, evictPolicy), "Unknown --evictPolicy=" << evictPolicyName);
+  DaoLogMode logMode;
+  NS_ABORT_MSG_UNLESS(ParseLogMode(logModeName, logMode), "Unknown --logMode=" << logModeName);
+  NS_ABORT_MSG_UNLESS(logPeriod > 0, "--logPeriod must be positive");
+  NS_ABORT_MSG_UNLESS(rxCoalesce >= 0, "--rxCoalesce must not be negative");
+  NS_ABORT_MSG_UNLESS(dupCacheAge > 0, "--dupCacheAge must be positive");
+
+  DaoTopologyMode topologyMode;
+  NS_ABORT_MSG_UNLESS(ParseTopologyMode(topologyName, topologyMode), "Unknown --topology=" << topologyName);
+  DaoRootAssign rootAssign;
+  NS_ABORT_MSG_UNLESS(ParseRootAssign(rootAssignName, rootAssign), "Unknown --rootAssign=" << rootAssignName);
+  NS_ABORT_MSG_UNLESS(nRoots >= 1, "--nRoots must be at least 1");
+  NS_ABORT_MSG_UNLESS(syncPeriod >= 0, "--syncPeriod must not be negative");
+  NS_ABORT_MSG_UNLESS(sensorsPerNode >= 1, "--sensorsPerNode must be at least 1");
+  NS_ABORT_MSG_UNLESS(sensorsPerNode == 1 || wireFormat == DaoWireFormat::Binary,
+                      "--sensorsPerNode > 1 needs --wireFormat=binary");
+  NS_ABORT_MSG_UNLESS(aggTick > 0, "--aggTick must be positive");
+
+  // nodes: sensor nodes (0..nNodes-1) + root (nNodes); logical sensor i lives on
+  // node i / sensorsPerNode
+  uint32_t nNodes = (nSensors + sensorsPerNode - 1) / sensorsPerNode;
+  DaoTopologyBuilder builder;
+  builder.SetMode(topologyMode);
+  builder.SetTreeShape(treeFanout, treeDepth);
+  builder.SetPartition(nRanks);
+  builder.SetRoots(nRoots, rootAssign);
+  int64_t setupStartNs = WallClockNs();
+  DaoTopology topo = builder.Build(nNodes);
+  int64_t topoDoneNs = WallClockNs();
+  // Every rank builds the whole topology but only runs the apps of its own nodes.
+  auto local = [rank](Ptr<Node> node) { return node->GetSystemId() == rank; };
+  NodeContainer &nodes = topo.nodes;
+  Ptr<Node> root = topo.root;              // root node
+
+  Ipv6Address rootAddr = topo.rootAddr;
+  Ipv6Address sensor0Addr = topo.sensorAddrs[0]; // sensor 0 IP
   uint16_t rootPort = 12345;
   uint16_t mirrorPort = 54321;
+  uint16_t syncPort = 12346;
+  // DAOs from node n go to its root
+  auto rootOfNode = [&](uint32_t n) { return Address(Inet6SocketAddress(topo.rootAddrs[topo.rootOf[n]], rootPort)); };
 
   NS_LOG_INFO("Root addr=" << rootAddr << " Sensor0 addr=" << sensor0Addr);
 
-  // Install root receiver
-  Ptr<DaoRootReceiverApp> rootApp = CreateObject<DaoRootReceiverApp>();
-  rootApp->Setup(Inet6SocketAddress(rootAddr, rootPort), Seconds(0.2)); // 0.2s threshold
-  root->AddApplication(rootApp);
-  rootApp->SetStartTime(Seconds(0.5));
-  rootApp->SetStopTime(Seconds(simTime));
-
-  // Install sensor sender apps
-  for (uint32_t i = 0; i < nSensors; ++i) {
-    Ptr<DaoSenderApp> sender = CreateObject<DaoSenderApp>();
-    Address mirror = Address();
-    if (i == 0) {
-      // sensor 0 mirrors to its own mirror port (attacker listens here)
-      mirror = Inet6SocketAddress(sensor0Addr, mirrorPort);
-    }
-    sender->Setup(Inet6SocketAddress(rootAddr, rootPort), mirror, 1 + i * 100, Seconds(10.0 + i));
-    nodes.Get(i)->AddApplication(sender);
-    sender->SetStartTime(Seconds(2.0 + i));
-    sender->SetStopTime(Seconds(simTime));
-  }
-
-  // Attacker app on sensor 0 (listens on mirror port and replays to root)
-  if (enableAttacker) {
+  // Per-root outputs get the root index appended to the path.
+  auto perRoot = [nRoots](const std::string &path, uint32_t r) {
+    return nRoots > 1 ? path + "." + std::to_string(r) : path;
+  };
+
+  // A resumed run starts where its snapshot was taken: every rank reads the time,
+  // the roots load their state below and the senders skip what was already sent.
+  Time resumeAt;
+  if (!resumeFrom.empty()) {
+    DaoSnapshotReader snap;
+    int64_t atNs = 0;
+    NS_ABORT_MSG_UNLESS(snap.Open(perRoot(resumeFrom, 0)) && snap.Get(atNs), "Cannot resume: " << snap.Error());
+    resumeAt = NanoSeconds(atNs);
+    NS_ABORT_MSG_UNLESS(resumeAt < Seconds(simTime), "--resumeFrom snapshot was taken at or after --simTime");
+  }
+  NS_ABORT_MSG_UNLESS(snapshotAt == 0 || (Seconds(snapshotAt) > resumeAt && snapshotAt < simTime),
+                      "--snapshotAt must lie within the simulated time (after the resume time)");
+
+  // Install the root receivers (on rank 0, which owns the roots), all writing into one
+  // metrics file: a row per root, tagged with its index when there are several.
+  std::vector<Ptr<DaoRootReceiverApp>> rootApps;
+  if (local(root)) {
+    std::vector<std::pair<std::string, std::string>> tags = {
+      {"run_id", std::to_string(runId)},
+      {"rng_seed", std::to_string(RngSeedManager::GetSeed())},
+      {"rng_run", std::to_string(RngSeedManager::GetRun())},
+      {"topology", topologyName},
+      {"n_sensors", std::to_string(nSensors)},
+      {"sim_time", std::to_string(simTime)},
+      {"wire_format", wireFormatName},
+      {"threshold", std::to_string(threshold)},
+      {"n_attackers", std::to_string(enableAttacker ? std::min(nAttackers, nNodes) : 0)},
+      {"attack_model", attackModelName},
+      {"replay_count", std::to_string(replayCount)},
+      {"replay_batch", std::to_string(replayBatch)},
+      {"capture_depth", std::to_string(captureDepth)}};
+    if (captureMode != DaoCaptureMode::Mirror) tags.emplace_back("capture_mode", captureModeName);
+    if (sensorsPerNode > 1) tags.emplace_back("sensors_per_node", std::to_string(sensorsPerNode));
+    if (distributed) tags.emplace_back("mpi_ranks", std::to_string(nRanks));
+    if (!resumeFrom.empty()) tags.emplace_back("resumed_at", std::to_string(resumeAt.GetSeconds()));
+    if (nRoots > 1) {
+      tags.insert(tags.end(), {{"n_roots", std::to_string(nRoots)},
+                               {"root_assign", rootAssignName},
+                               {"sync_period", std::to_string(syncPeriod)},
+                               {"root", ""}}); // per root, below
+    }
+    std::istringstream extra(runTags);
+    for (std::string kv; std::getline(extra, kv, ';');) {
+      size_t eq = kv.find('=');
+      if (eq != std::string::npos) tags.emplace_back("sweep_" + kv.substr(0, eq), kv.substr(eq + 1));
+    }
+    auto metrics = std::make_shared<DaoMetricsWriter>();
+    metrics->Open(metricsFile, metricsFormat, metricsMode);
+
+    for (uint32_t r = 0; r < nRoots; ++r) {
+      Ptr<DaoRootReceiverApp> rootApp = CreateObject<DaoRootReceiverApp>();
+      rootApp->Setup(Inet6SocketAddress(topo.rootAddrs[r], rootPort), Seconds(threshold));
+      std::unique_ptr<FreshnessPolicy> policy = MakeFreshnessPolicy(freshnessName, Seconds(threshold).GetNanoSeconds());
+      NS_ABORT_MSG_UNLESS(policy, "Unknown --freshness=" << freshnessName);
+      rootApp->SetFreshnessPolicy(std::move(policy));
+      rootApp->SetMetricsOutput(metrics);
+      if (nRoots > 1) {
+        for (auto &t : tags) if (t.first == "root") t.second = std::to_string(r);
+        rootApp->SetLabel(std::to_string(r) + " of " + std::to_string(nRoots));
+      }
+      rootApp->SetRunTags(tags);
+      rootApp->SetLogMode(logMode, Seconds(logPeriod));
+      rootApp->EnableProfiling(profileRoot);
+      rootApp->SetSenderCapacity(senderCapacity, evictPolicy);
+      rootApp->SetBatchReceive(rxBatch, Seconds(rxCoalesce));
+      rootApp->SetDupCache(dupCache, Seconds(dupCacheAge));
+      if (nRoots > 1 && syncPeriod > 0) {
+        std::vector<Address> peers;
+        for (uint32_t q = 0; q < nRoots; ++q) {
+          if (q != r) peers.push_back(Inet6SocketAddress(topo.syncAddrs[q], syncPort));
+        }
+        rootApp->EnableSync(Inet6SocketAddress(topo.syncAddrs[r], syncPort), peers, Seconds(syncPeriod));
+      }
+      if (!traceOut.empty()) {
+        NS_ABORT_MSG_UNLESS(rootApp->EnableTrace(perRoot(traceOut, r)), "Cannot create --traceOut=" << perRoot(traceOut, r));
+      }
+      if (sampleInterval > 0) rootApp->EnableSampling(Seconds(sampleInterval), sampleBuffer, perRoot(sampleFile, r), metricsFormat);
+      if (!resumeFrom.empty()) {
+        Time at;
+        std::string error;
+        NS_ABORT_MSG_UNLESS(rootApp->LoadSnapshot(perRoot(resumeFrom, r), at, error), "Cannot resume: " << error);
+        NS_ABORT_MSG_UNLESS(at == resumeAt, "The roots' snapshots were taken at different times");
+        rootApp->SetResumeOverlap(topo.maxPathDelay);
+      }
+      if (snapshotAt > 0) rootApp->ScheduleSnapshot(Seconds(snapshotAt), perRoot(snapshotOut, r));
+      topo.roots.Get(r)->AddApplication(rootApp);
+      rootApp->SetStartTime(std::max(Seconds(0.5), resumeAt));
+      rootApp->SetStopTime(Seconds(simTime));
+      rootApps.push_back(rootApp);
+    }
+  }
+
+  // Attacker host nodes, each capturing its first sensor; the remaining sensors are
+  // dealt round-robin to attackers until each has victimsPerAttacker victims.
+  // RNG streams: sensor (node) i uses stream i, placement stream nSensors, and
+  // attacker a stream nSensors + 1 + a, so every draw is a function of (RngSeed, RngRun) only.
+  int64_t stream = nSensors;
+  std::vector<uint32_t> attackerHosts;
+  if (enableAttacker) attackerHosts = PlaceAttackers(nNodes, nAttackers, attackerPlacement, stream);
+  ++stream;
+  std::vector<int32_t> capturedBy(nSensors, -1); // attacker host node mirroring sensor i
+  for (uint32_t host : attackerHosts) capturedBy[host * sensorsPerNode] = host;
+  if (!attackerHosts.empty() && victimsPerAttacker > 1) {
+    std::vector<uint32_t> victims(attackerHosts.size(), 1);
+    uint32_t a = 0, full = 0;
+    for (uint32_t i = 0; i < nSensors && full < attackerHosts.size(); ++i) {
+      if (capturedBy[i] >= 0) continue;
+      while (victims[a] >= victimsPerAttacker) a = (a + 1) % attackerHosts.size();
+      capturedBy[i] = attackerHosts[a];
+      if (++victims[a] == victimsPerAttacker) ++full;
+      a = (a + 1) % attackerHosts.size();
+    }
+  }
+
+  // One payload pool per sensor node, shared by its sender and attacker apps
+  std::vector<std::shared_ptr<DaoPayloadPool>> pools(nNodes);
+  auto poolOf = [&pools](uint32_t n) {
+    if (!pools[n]) pools[n] = std::make_shared<DaoPayloadPool>();
+    return pools[n];
+  };
+
+  // Install sensor sender apps: one per sensor, or one aggregate per node. Resumed
+  // senders start one path delay bound before the snapshot (see SetResumeOverlap).
+  Time resendFrom = std::max(resumeAt - topo.maxPathDelay, Time(0));
+  auto mirrorOf = [&](uint32_t i) {
+    // victims mirror to their attacker's mirror port (attacker listens here)
+    if (captureMode == DaoCaptureMode::Sniff) return Address();
+    return capturedBy[i] >= 0 ? Address(Inet6SocketAddress(topo.sensorAddrs[capturedBy[i]], mirrorPort)) : Address();
+  };
+  if (sensorsPerNode == 1) {
+    for (uint32_t i = 0; i < nSensors; ++i) {
+      if (!local(nodes.Get(i))) continue;
+      Ptr<DaoSenderApp> sender = CreateObject<DaoSenderApp>();
+      sender->Setup(rootOfNode(i), mirrorOf(i), 1 + i * 100, Seconds(10.0 + i));
+      sender->SetWireFormat(wireFormat);
+      sender->SetPayloadPool(poolOf(i));
+      sender->SetResumeAt(resendFrom);
+      sender->AssignStreams(i);
+      nodes.Get(i)->AddApplication(sender);
+      sender->SetStartTime(Seconds(2.0 + i));
+      sender->SetStopTime(Seconds(simTime));
+    }
+  } else {
+    for (uint32_t n = 0; n < nNodes; ++n) {
+      if (!local(nodes.Get(n))) continue;
+      Ptr<DaoAggregateSenderApp> sender = CreateObject<DaoAggregateSenderApp>();
+      sender->Setup(rootOfNode(n), Seconds(aggTick));
+      for (uint32_t i = n * sensorsPerNode; i < std::min(nSensors, (n + 1) * sensorsPerNode); ++i) {
+        sender->AddSensor(i, 1 + i * 100, Seconds(2.0 + i), Seconds(10.0 + i), mirrorOf(i));
+      }
+      sender->SetPayloadPool(poolOf(n));
+      sender->SetResumeAt(resendFrom);
+      sender->AssignStreams(n);
+      nodes.Get(n)->AddApplication(sender);
+      sender->SetStartTime(Seconds(0.0));
+      sender->SetStopTime(Seconds(simTime));
+    }
+  }
+
+  // Attacker apps on the compromised sensors (listen on mirror port, or sniff, and replay to root)
+  std::vector<Ptr<DaoAttackerApp>> attackers;
+  for (uint32_t a = 0; a < attackerHosts.size(); ++a) {
+    uint32_t host = attackerHosts[a];
+    if (!local(nodes.Get(host))) continue;
     Ptr<DaoAttackerApp> atk = CreateObject<DaoAttackerApp>();
-    atk->Setup(Inet6SocketAddress(sensor0Addr, mirrorPort), Inet6SocketAddress(rootAddr, rootPort), 100, Seconds(0.01));
-    attackerNode->AddApplication(atk);
+    Address listen = Inet6SocketAddress(topo.sensorAddrs[host], mirrorPort);
+    if (captureMode == DaoCaptureMode::Sniff) {
+      listen = Address();
+      for (uint32_t i = 0; i < nSensors; ++i) {
+        if (capturedBy[i] != (int32_t)host) continue;
+        uint32_t node = i / sensorsPerNode;
+        NS_ABORT_MSG_UNLESS(nodes.Get(node)->GetSystemId() == nodes.Get(host)->GetSystemId(),
+                            "sniff capture needs each victim on its attacker's rank");
+        DaoSenderKey victim;
+        topo.sensorAddrs[node].GetBytes(victim.addr);
+        if (sensorsPerNode > 1) PutU32(victim.addr + 12, i); // as ApplyDaoOrigin
+        atk->AddSniffTarget(nodes.Get(node), victim, rootPort);
+      }
+    }
+    atk->Setup(listen, rootOfNode(host), replayCount, Seconds(replayGap));
+    atk->SetRestorm(captureDepth > 1 || victimsPerAttacker > 1);
+    atk->SetTrafficModel(attackModel, replayBatch, Seconds(attackOnTime), Seconds(attackOffTime));
+    atk->SetCaptureDepth(captureDepth);
+    atk->SetPayloadPool(poolOf(host));
+    atk->SetLogMode(logMode, Seconds(logPeriod));
+    // By global index, so every rank and a single-process run agree.
+    atk->AssignStreams(stream + a * DaoAttackerApp::kStreams);
+    nodes.Get(host)->AddApplication(atk);
     atk->SetStartTime(Seconds(3.0));
     atk->SetStopTime(Seconds(simTime));
+    attackers.push_back(atk);
   }
 
-  // Build simple routing (global)
-  GlobalRouteManager::BuildGlobalRoutingDatabase();
-  GlobalRouteManager::InitializeRoutes();
+  // The builder installed every route; global routing is IPv4-only and has nothing to do.
+  int64_t setupDoneNs = WallClockNs();
+  for (const auto &app : rootApps) app->SetStartupCost(topoDoneNs - setupStartNs, setupDoneNs - topoDoneNs, nNodes);
 
   Simulator::Stop(Seconds(simTime));
   Simulator::Run();
+
+  // Attackers and pools live wherever their node does; fold their counters into
+  // root 0's summary, over every rank when distributed.
+  DaoPoolStats pool;
+  uint64_t poolNodes = 0;
+  for (const auto &p : pools) {
+    if (!p) continue;
+    pool.Add(p->Stats());
+    ++poolNodes;
+  }
+  uint64_t totals[7] = {0, 0, poolNodes, pool.acquires, pool.releases, pool.slabs, pool.blocks};
+  for (const auto &atk : attackers) {
+    totals[0] += atk->Captured();
+    totals[1] += atk->Replayed();
+  }
+#ifdef NS3_MPI
+  if (distributed) {
+    uint64_t all[7] = {}, peak = 0;
+    MPI_Reduce(totals, all, 7, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&pool.peakInUse, &peak, 1, MPI_UINT64_T, MPI_MAX, 0, MPI_COMM_WORLD);
+    std::copy(all, all + 7, totals);
+    pool.peakInUse = peak;
+  }
+#endif
+  if (!rootApps.empty()) {
+    if (distributed) rootApps[0]->SetAttackTotals(totals[0], totals[1]);
+    pool.acquires = totals[3]; pool.releases = totals[4]; pool.slabs = totals[5];
+    pool.blocks = totals[6];
+    rootApps[0]->SetPoolTotals(totals[2], pool);
+  }
   Simulator::Destroy();
+#ifdef NS3_MPI
+  if (distributed) MpiInterface::Disable();
+#endif
   return 0;
 }
 